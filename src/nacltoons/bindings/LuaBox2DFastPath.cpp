@@ -0,0 +1,282 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Hand-tuned replacements for the hottest functions in the generated
+// LuaBox2D.cpp glue.  See LuaBox2DFastPath.h for the rationale.
+
+#include "LuaBox2DFastPath.h"
+
+#include "Box2D/Box2D.h"
+#include "frame_profiler.h"
+
+extern "C" {
+#include "lua.h"
+#include "lauxlib.h"
+}
+
+// In release builds self and argument extraction is a raw userdata
+// dereference; the generated bindings have already established that
+// only correctly-typed userdata reaches these metatables in practice,
+// and debug builds keep the full tolua++ checks.
+#ifndef TOLUA_RELEASE
+#define FAST_SELF(L, type, name)                                       \
+  FrameProfiler::sharedProfiler()->CountBindingCall();                 \
+  type* name;                                                          \
+  {                                                                    \
+    tolua_Error tolua_err;                                             \
+    if (!tolua_isusertype(L, 1, #type, 0, &tolua_err))                 \
+      tolua_error(L, "invalid 'self' in fast-path function", &tolua_err); \
+    name = (type*)tolua_tousertype(L, 1, 0);                           \
+  }
+#else
+#define FAST_SELF(L, type, name)                       \
+  FrameProfiler::sharedProfiler()->CountBindingCall(); \
+  type* name = *(type**)lua_touserdata(L, 1);
+#endif
+
+namespace {
+
+// Read a b2Vec2 argument starting at stack index |index|.  Accepts
+// either two plain numbers (the fast convention) or a boxed b2Vec2
+// userdata (the generated-bindings convention).  Returns the index
+// of the first stack slot after the vector.
+int ReadVec2(lua_State* L, int index, b2Vec2* out) {
+  if (lua_type(L, index) == LUA_TNUMBER) {
+    out->Set(lua_tonumber(L, index), lua_tonumber(L, index + 1));
+    return index + 2;
+  }
+  *out = **(b2Vec2**)lua_touserdata(L, index);
+  return index + 1;
+}
+
+int FastBody_SetLinearVelocity(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  b2Vec2 v;
+  ReadVec2(L, 2, &v);
+  self->SetLinearVelocity(v);
+  return 0;
+}
+
+int FastBody_GetLinearVelocity(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  const b2Vec2& v = self->GetLinearVelocity();
+  tolua_pushusertype(L, (void*)&v, "const b2Vec2");
+  return 1;
+}
+
+int FastBody_SetAngularVelocity(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  self->SetAngularVelocity(lua_tonumber(L, 2));
+  return 0;
+}
+
+int FastBody_GetAngularVelocity(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  lua_pushnumber(L, self->GetAngularVelocity());
+  return 1;
+}
+
+int FastBody_GetPosition(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  const b2Vec2& pos = self->GetPosition();
+  tolua_pushusertype(L, (void*)&pos, "const b2Vec2");
+  return 1;
+}
+
+int FastBody_GetAngle(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  lua_pushnumber(L, self->GetAngle());
+  return 1;
+}
+
+int FastBody_SetTransform(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  b2Vec2 pos;
+  int next = ReadVec2(L, 2, &pos);
+  self->SetTransform(pos, lua_tonumber(L, next));
+  return 0;
+}
+
+int FastBody_ApplyForce(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  b2Vec2 force;
+  b2Vec2 point;
+  int next = ReadVec2(L, 2, &force);
+  ReadVec2(L, next, &point);
+  self->ApplyForce(force, point);
+  return 0;
+}
+
+int FastBody_ApplyLinearImpulse(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  b2Vec2 impulse;
+  b2Vec2 point;
+  int next = ReadVec2(L, 2, &impulse);
+  ReadVec2(L, next, &point);
+  self->ApplyLinearImpulse(impulse, point);
+  return 0;
+}
+
+int FastBody_SetAwake(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  self->SetAwake(lua_toboolean(L, 2) != 0);
+  return 0;
+}
+
+int FastBody_IsAwake(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  lua_pushboolean(L, self->IsAwake());
+  return 1;
+}
+
+// --- Unboxed value-type fast path -----------------------------------
+//
+// Boxed b2Vec2 results are heap-allocated tolua userdata and churn
+// the lua GC when scripts read or write vectors every frame.  Two
+// complementary paths avoid that:
+//  - *XY getters return plain numbers and allocate nothing.
+//  - b2Vec2.obtain/recycle manage a freelist of self-contained
+//    userdata (the vector value lives inside the userdata block) so
+//    steady-state use of boxed vectors also allocates nothing.
+
+int FastBody_GetPositionXY(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  const b2Vec2& pos = self->GetPosition();
+  lua_pushnumber(L, pos.x);
+  lua_pushnumber(L, pos.y);
+  return 2;
+}
+
+int FastBody_GetLinearVelocityXY(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  const b2Vec2& v = self->GetLinearVelocity();
+  lua_pushnumber(L, v.x);
+  lua_pushnumber(L, v.y);
+  return 2;
+}
+
+// Returns the full transform as (x, y, angle) without boxing a
+// b2Transform.
+int FastBody_GetTransformXY(lua_State* L) {
+  FAST_SELF(L, b2Body, self);
+  const b2Transform& xf = self->GetTransform();
+  lua_pushnumber(L, xf.p.x);
+  lua_pushnumber(L, xf.p.y);
+  lua_pushnumber(L, self->GetAngle());
+  return 3;
+}
+
+// b2Vec2.obtain(x, y) -> vec.  Pops a recycled vector userdata off
+// the freelist (upvalue 2) or creates a new one with the b2Vec2
+// value embedded in the userdata block itself, so nothing is
+// heap-allocated outside the lua GC and nothing leaks when an
+// unrecycled vector is eventually collected.  The b2Vec2 metatable
+// is attached from upvalue 1 without any registry lookup.
+int FastVec2_Obtain(lua_State* L) {
+  float x = lua_tonumber(L, 1);
+  float y = lua_tonumber(L, 2);
+
+  size_t n = lua_objlen(L, lua_upvalueindex(2));
+  if (n > 0) {
+    lua_rawgeti(L, lua_upvalueindex(2), n);
+    lua_pushnil(L);
+    lua_rawseti(L, lua_upvalueindex(2), n);
+  } else {
+    void** ud = (void**)lua_newuserdata(L, sizeof(void*) + sizeof(b2Vec2));
+    *ud = ud + 1;
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_setmetatable(L, -2);
+  }
+
+  b2Vec2* vec = *(b2Vec2**)lua_touserdata(L, -1);
+  vec->Set(x, y);
+  return 1;
+}
+
+// b2Vec2.recycle(vec).  Pushes the vector back on the freelist so a
+// later obtain() can reuse it.  The caller must not use the vector
+// after recycling it.
+int FastVec2_Recycle(lua_State* L) {
+  lua_pushvalue(L, 1);
+  lua_rawseti(L, lua_upvalueindex(2), lua_objlen(L, lua_upvalueindex(2)) + 1);
+  return 0;
+}
+
+int FastWorld_Step(lua_State* L) {
+  FAST_SELF(L, b2World, self);
+  ScopedTimer timer(PROFILE_WORLD_STEP);
+  self->Step(lua_tonumber(L, 2), (int)lua_tonumber(L, 3),
+             (int)lua_tonumber(L, 4));
+  return 0;
+}
+
+// Replace |name| in the class table currently on the top of the
+// stack with the given function.  None of the fast-path methods need
+// upvalues; the ones that do (the b2Vec2 pool) build their closures
+// explicitly below.
+void PatchMethod(lua_State* L, const char* name, lua_CFunction fn) {
+  lua_pushstring(L, name);
+  lua_pushcclosure(L, fn, 0);
+  lua_rawset(L, -3);
+}
+
+// Push the tolua class table registered under |classname| or leave
+// nothing on the stack and return false if it does not exist.
+bool PushClassTable(lua_State* L, const char* classname) {
+  lua_pushstring(L, classname);
+  lua_rawget(L, LUA_REGISTRYINDEX);
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+TOLUA_API int tolua_LuaBox2D_fastpath_open(lua_State* tolua_S) {
+  if (PushClassTable(tolua_S, "b2Body")) {
+    PatchMethod(tolua_S, "SetLinearVelocity", FastBody_SetLinearVelocity);
+    PatchMethod(tolua_S, "GetLinearVelocity", FastBody_GetLinearVelocity);
+    PatchMethod(tolua_S, "SetAngularVelocity", FastBody_SetAngularVelocity);
+    PatchMethod(tolua_S, "GetAngularVelocity", FastBody_GetAngularVelocity);
+    PatchMethod(tolua_S, "GetPosition", FastBody_GetPosition);
+    PatchMethod(tolua_S, "GetAngle", FastBody_GetAngle);
+    PatchMethod(tolua_S, "SetTransform", FastBody_SetTransform);
+    PatchMethod(tolua_S, "ApplyForce", FastBody_ApplyForce);
+    PatchMethod(tolua_S, "ApplyLinearImpulse", FastBody_ApplyLinearImpulse);
+    PatchMethod(tolua_S, "SetAwake", FastBody_SetAwake);
+    PatchMethod(tolua_S, "IsAwake", FastBody_IsAwake);
+    PatchMethod(tolua_S, "GetPositionXY", FastBody_GetPositionXY);
+    PatchMethod(tolua_S, "GetLinearVelocityXY", FastBody_GetLinearVelocityXY);
+    PatchMethod(tolua_S, "GetTransformXY", FastBody_GetTransformXY);
+    lua_pop(tolua_S, 1);
+  }
+
+  if (PushClassTable(tolua_S, "b2Vec2")) {
+    // The freelist table shared by obtain and recycle.
+    lua_newtable(tolua_S);
+
+    lua_pushstring(tolua_S, "obtain");
+    lua_pushvalue(tolua_S, -3);  // b2Vec2 class table (the metatable)
+    lua_pushvalue(tolua_S, -3);  // freelist
+    lua_pushcclosure(tolua_S, FastVec2_Obtain, 2);
+    lua_rawset(tolua_S, -4);
+
+    lua_pushstring(tolua_S, "recycle");
+    lua_pushvalue(tolua_S, -3);
+    lua_pushvalue(tolua_S, -3);
+    lua_pushcclosure(tolua_S, FastVec2_Recycle, 2);
+    lua_rawset(tolua_S, -4);
+
+    lua_pop(tolua_S, 2);
+  }
+
+  if (PushClassTable(tolua_S, "b2World")) {
+    PatchMethod(tolua_S, "Step", FastWorld_Step);
+    lua_pop(tolua_S, 1);
+  }
+
+  return 1;
+}
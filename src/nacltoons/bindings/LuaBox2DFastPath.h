@@ -0,0 +1,29 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef LUA_BOX2D_FAST_PATH_H_
+#define LUA_BOX2D_FAST_PATH_H_
+
+extern "C" {
+#include "tolua++.h"
+}
+
+/**
+ * Hand-written fast-path overrides for the hottest entry points in
+ * the generated LuaBox2D bindings (b2Body setters/getters and
+ * b2World::Step).  Unlike the generated glue these functions skip
+ * per-call string-keyed type checking in release builds and accept
+ * plain numbers in place of boxed b2Vec2 arguments on setters, so
+ * per-frame scripting does not pay tolua++ dispatch costs.
+ *
+ * It also installs a value-type fast path for b2Vec2: unboxed *XY
+ * getters on b2Body that return plain numbers, and a
+ * b2Vec2.obtain/recycle freelist so scripts that need boxed vectors
+ * every frame can run without allocating.
+ *
+ * Must be called after tolua_LuaBox2D_open so the class tables it
+ * patches already exist.  This file is NOT generated by tolua++.
+ */
+TOLUA_API int tolua_LuaBox2D_fastpath_open(lua_State* tolua_S);
+
+#endif  // LUA_BOX2D_FAST_PATH_H_
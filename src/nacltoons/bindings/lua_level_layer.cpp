@@ -19,6 +19,7 @@ TOLUA_API int  tolua_level_layer_open (lua_State* tolua_S);
 #include "lua_level_layer.h"
 #include "level_layer.h"
 #include "game_manager.h"
+#include "lua_lazy_bindings.h"
 #include "tolua_fix.h"
 
 /* function to register type */
@@ -52,6 +53,7 @@ static int tolua_level_layer_LevelLayer_GetWorld00(lua_State* tolua_S)
 #endif
   {
    b2World* tolua_ret = (b2World*)  self->GetWorld();
+    LuaLazyEnsure(tolua_S,"LuaBox2D");
     tolua_pushusertype(tolua_S,(void*)tolua_ret,"b2World");
   }
  }
@@ -161,6 +163,270 @@ static int tolua_level_layer_LevelLayer_FindBodiesAt00(lua_State* tolua_S)
 }
 #endif //#ifndef TOLUA_DISABLE
 
+/* method: FindBodiesAtPoints of class  LevelLayer */
+#ifndef TOLUA_DISABLE_tolua_level_layer_LevelLayer_FindBodiesAtPoints00
+static int tolua_level_layer_LevelLayer_FindBodiesAtPoints00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"LevelLayer",0,&tolua_err) ||
+     !toluafix_istable(tolua_S,2,0,&tolua_err) ||
+     !tolua_isnumber(tolua_S,3,0,&tolua_err) ||
+     (tolua_isvaluenil(tolua_S,4,&tolua_err) || !toluafix_isfunction(tolua_S,4,"LUA_FUNCTION",0,&tolua_err)) ||
+     !tolua_isnoobj(tolua_S,5,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  LevelLayer* self = (LevelLayer*)  tolua_tousertype(tolua_S,1,0);
+  LUA_TABLE points = ((LUA_TABLE)  toluafix_totable(tolua_S,2,0));
+  int count = ((int)  tolua_tonumber(tolua_S,3,0));
+  LUA_FUNCTION callback = ( toluafix_ref_function(tolua_S,4,0));
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'FindBodiesAtPoints'", NULL);
+#endif
+  {
+   self->FindBodiesAtPoints(points,count,callback);
+  }
+ }
+ return 0;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'FindBodiesAtPoints'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
+/* method: SetPhysicsThreadEnabled of class  LevelLayer */
+#ifndef TOLUA_DISABLE_tolua_level_layer_LevelLayer_SetPhysicsThreadEnabled00
+static int tolua_level_layer_LevelLayer_SetPhysicsThreadEnabled00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"LevelLayer",0,&tolua_err) ||
+     !tolua_isboolean(tolua_S,2,0,&tolua_err) ||
+     !tolua_isnoobj(tolua_S,3,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  LevelLayer* self = (LevelLayer*)  tolua_tousertype(tolua_S,1,0);
+  bool enabled = ((bool)  tolua_toboolean(tolua_S,2,0));
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'SetPhysicsThreadEnabled'", NULL);
+#endif
+  {
+   self->SetPhysicsThreadEnabled(enabled);
+  }
+ }
+ return 0;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'SetPhysicsThreadEnabled'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
+/* method: PhysicsThreadEnabled of class  LevelLayer */
+#ifndef TOLUA_DISABLE_tolua_level_layer_LevelLayer_PhysicsThreadEnabled00
+static int tolua_level_layer_LevelLayer_PhysicsThreadEnabled00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"LevelLayer",0,&tolua_err) ||
+     !tolua_isnoobj(tolua_S,2,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  LevelLayer* self = (LevelLayer*)  tolua_tousertype(tolua_S,1,0);
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'PhysicsThreadEnabled'", NULL);
+#endif
+  {
+   bool tolua_ret = (bool)  self->PhysicsThreadEnabled();
+   tolua_pushboolean(tolua_S,(bool)tolua_ret);
+  }
+ }
+ return 1;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'PhysicsThreadEnabled'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
+/* method: SetParallelPhysicsEnabled of class  LevelLayer */
+#ifndef TOLUA_DISABLE_tolua_level_layer_LevelLayer_SetParallelPhysicsEnabled00
+static int tolua_level_layer_LevelLayer_SetParallelPhysicsEnabled00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"LevelLayer",0,&tolua_err) ||
+     !tolua_isboolean(tolua_S,2,0,&tolua_err) ||
+     !tolua_isnoobj(tolua_S,3,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  LevelLayer* self = (LevelLayer*)  tolua_tousertype(tolua_S,1,0);
+  bool enabled = ((bool)  tolua_toboolean(tolua_S,2,0));
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'SetParallelPhysicsEnabled'", NULL);
+#endif
+  {
+   self->SetParallelPhysicsEnabled(enabled);
+  }
+ }
+ return 0;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'SetParallelPhysicsEnabled'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
+/* method: ParallelPhysicsEnabled of class  LevelLayer */
+#ifndef TOLUA_DISABLE_tolua_level_layer_LevelLayer_ParallelPhysicsEnabled00
+static int tolua_level_layer_LevelLayer_ParallelPhysicsEnabled00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"LevelLayer",0,&tolua_err) ||
+     !tolua_isnoobj(tolua_S,2,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  LevelLayer* self = (LevelLayer*)  tolua_tousertype(tolua_S,1,0);
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'ParallelPhysicsEnabled'", NULL);
+#endif
+  {
+   bool tolua_ret = (bool)  self->ParallelPhysicsEnabled();
+   tolua_pushboolean(tolua_S,(bool)tolua_ret);
+  }
+ }
+ return 1;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'ParallelPhysicsEnabled'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
+/* method: LockWorld of class  LevelLayer */
+#ifndef TOLUA_DISABLE_tolua_level_layer_LevelLayer_LockWorld00
+static int tolua_level_layer_LevelLayer_LockWorld00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"LevelLayer",0,&tolua_err) ||
+     !tolua_isnoobj(tolua_S,2,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  LevelLayer* self = (LevelLayer*)  tolua_tousertype(tolua_S,1,0);
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'LockWorld'", NULL);
+#endif
+  {
+   self->LockWorld();
+  }
+ }
+ return 0;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'LockWorld'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
+/* method: UnlockWorld of class  LevelLayer */
+#ifndef TOLUA_DISABLE_tolua_level_layer_LevelLayer_UnlockWorld00
+static int tolua_level_layer_LevelLayer_UnlockWorld00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"LevelLayer",0,&tolua_err) ||
+     !tolua_isnoobj(tolua_S,2,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  LevelLayer* self = (LevelLayer*)  tolua_tousertype(tolua_S,1,0);
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'UnlockWorld'", NULL);
+#endif
+  {
+   self->UnlockWorld();
+  }
+ }
+ return 0;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'UnlockWorld'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
+/* method: SetBodyInterest of class  LevelLayer */
+#ifndef TOLUA_DISABLE_tolua_level_layer_LevelLayer_SetBodyInterest00
+static int tolua_level_layer_LevelLayer_SetBodyInterest00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"LevelLayer",0,&tolua_err) ||
+     !tolua_isnumber(tolua_S,2,0,&tolua_err) ||
+     !tolua_isnumber(tolua_S,3,0,&tolua_err) ||
+     !tolua_isnoobj(tolua_S,4,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  LevelLayer* self = (LevelLayer*)  tolua_tousertype(tolua_S,1,0);
+  int tag = ((int)  tolua_tonumber(tolua_S,2,0));
+  unsigned int mask = ((unsigned int)  tolua_tonumber(tolua_S,3,0));
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'SetBodyInterest'", NULL);
+#endif
+  {
+   self->SetBodyInterest(tag,mask);
+  }
+ }
+ return 0;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'SetBodyInterest'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
 /* method: sharedManager of class  GameManager */
 #ifndef TOLUA_DISABLE_tolua_level_layer_GameManager_sharedManager00
 static int tolua_level_layer_GameManager_sharedManager00(lua_State* tolua_S)
@@ -253,6 +519,72 @@ static int tolua_level_layer_GameManager_LoadLevel00(lua_State* tolua_S)
 }
 #endif //#ifndef TOLUA_DISABLE
 
+/* method: LoadLevelAsync of class  GameManager */
+#ifndef TOLUA_DISABLE_tolua_level_layer_GameManager_LoadLevelAsync00
+static int tolua_level_layer_GameManager_LoadLevelAsync00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"GameManager",0,&tolua_err) ||
+     !tolua_isnumber(tolua_S,2,0,&tolua_err) ||
+     !tolua_isnoobj(tolua_S,3,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  GameManager* self = (GameManager*)  tolua_tousertype(tolua_S,1,0);
+  int level_number = ((int)  tolua_tonumber(tolua_S,2,0));
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'LoadLevelAsync'", NULL);
+#endif
+  {
+   self->LoadLevelAsync(level_number);
+  }
+ }
+ return 0;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'LoadLevelAsync'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
+/* method: PrefetchLevel of class  GameManager */
+#ifndef TOLUA_DISABLE_tolua_level_layer_GameManager_PrefetchLevel00
+static int tolua_level_layer_GameManager_PrefetchLevel00(lua_State* tolua_S)
+{
+#ifndef TOLUA_RELEASE
+ tolua_Error tolua_err;
+ if (
+     !tolua_isusertype(tolua_S,1,"GameManager",0,&tolua_err) ||
+     !tolua_isnumber(tolua_S,2,0,&tolua_err) ||
+     !tolua_isnoobj(tolua_S,3,&tolua_err)
+ )
+  goto tolua_lerror;
+ else
+#endif
+ {
+  GameManager* self = (GameManager*)  tolua_tousertype(tolua_S,1,0);
+  int level_number = ((int)  tolua_tonumber(tolua_S,2,0));
+#ifndef TOLUA_RELEASE
+  if (!self) tolua_error(tolua_S,"invalid 'self' in function 'PrefetchLevel'", NULL);
+#endif
+  {
+   self->PrefetchLevel(level_number);
+  }
+ }
+ return 0;
+#ifndef TOLUA_RELEASE
+ tolua_lerror:
+ tolua_error(tolua_S,"#ferror in function 'PrefetchLevel'.",&tolua_err);
+ return 0;
+#endif
+}
+#endif //#ifndef TOLUA_DISABLE
+
 /* method: LoadGame of class  GameManager */
 #ifndef TOLUA_DISABLE_tolua_level_layer_GameManager_LoadGame00
 static int tolua_level_layer_GameManager_LoadGame00(lua_State* tolua_S)
@@ -299,12 +631,22 @@ TOLUA_API int tolua_level_layer_open (lua_State* tolua_S)
    tolua_function(tolua_S,"LevelComplete",tolua_level_layer_LevelLayer_LevelComplete00);
    tolua_function(tolua_S,"ToggleDebug",tolua_level_layer_LevelLayer_ToggleDebug00);
    tolua_function(tolua_S,"FindBodiesAt",tolua_level_layer_LevelLayer_FindBodiesAt00);
+   tolua_function(tolua_S,"FindBodiesAtPoints",tolua_level_layer_LevelLayer_FindBodiesAtPoints00);
+   tolua_function(tolua_S,"SetPhysicsThreadEnabled",tolua_level_layer_LevelLayer_SetPhysicsThreadEnabled00);
+   tolua_function(tolua_S,"PhysicsThreadEnabled",tolua_level_layer_LevelLayer_PhysicsThreadEnabled00);
+   tolua_function(tolua_S,"SetParallelPhysicsEnabled",tolua_level_layer_LevelLayer_SetParallelPhysicsEnabled00);
+   tolua_function(tolua_S,"ParallelPhysicsEnabled",tolua_level_layer_LevelLayer_ParallelPhysicsEnabled00);
+   tolua_function(tolua_S,"LockWorld",tolua_level_layer_LevelLayer_LockWorld00);
+   tolua_function(tolua_S,"UnlockWorld",tolua_level_layer_LevelLayer_UnlockWorld00);
+   tolua_function(tolua_S,"SetBodyInterest",tolua_level_layer_LevelLayer_SetBodyInterest00);
   tolua_endmodule(tolua_S);
   tolua_cclass(tolua_S,"GameManager","GameManager","",NULL);
   tolua_beginmodule(tolua_S,"GameManager");
    tolua_function(tolua_S,"sharedManager",tolua_level_layer_GameManager_sharedManager00);
    tolua_function(tolua_S,"Restart",tolua_level_layer_GameManager_Restart00);
    tolua_function(tolua_S,"LoadLevel",tolua_level_layer_GameManager_LoadLevel00);
+   tolua_function(tolua_S,"LoadLevelAsync",tolua_level_layer_GameManager_LoadLevelAsync00);
+   tolua_function(tolua_S,"PrefetchLevel",tolua_level_layer_GameManager_PrefetchLevel00);
    tolua_function(tolua_S,"LoadGame",tolua_level_layer_GameManager_LoadGame00);
   tolua_endmodule(tolua_S);
  tolua_endmodule(tolua_S);
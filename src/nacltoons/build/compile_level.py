@@ -0,0 +1,96 @@
+#!/usr/bin/env python
+# Copyright (c) 2013 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Compile a YAML level def into the binary level format.
+
+YAML parsing dominates the level-load profile, so published builds
+ship levels pre-compiled.  The output is decoded straight into a lua
+table by src/level_def.cc; the YAML source remains the dev-mode
+fallback (see util.LoadLevelDef).
+
+The format is a 12 byte header (magic 'NTLD', version uint32,
+reserved uint32) followed by one encoded value:
+
+  0x00  nil
+  0x01  false
+  0x02  true
+  0x03  number: 8-byte little-endian double
+  0x04  string: uint32 length + bytes
+  0x05  table:  uint32 array_count, uint32 hash_count,
+        array_count encoded values (lua indices 1..n), then
+        hash_count pairs of (string key, encoded value)
+
+Usage: compile_level.py -o level1.defb level1.def
+"""
+
+import optparse
+import struct
+import sys
+
+import yaml
+
+LEVEL_MAGIC = 'NTLD'
+LEVEL_VERSION = 1
+
+TYPE_NIL = 0
+TYPE_FALSE = 1
+TYPE_TRUE = 2
+TYPE_NUMBER = 3
+TYPE_STRING = 4
+TYPE_TABLE = 5
+
+
+def EncodeValue(out, value):
+  if value is None:
+    out.append(struct.pack('<B', TYPE_NIL))
+  elif value is True:
+    out.append(struct.pack('<B', TYPE_TRUE))
+  elif value is False:
+    out.append(struct.pack('<B', TYPE_FALSE))
+  elif isinstance(value, (int, long, float)):
+    out.append(struct.pack('<Bd', TYPE_NUMBER, float(value)))
+  elif isinstance(value, str):
+    out.append(struct.pack('<BI', TYPE_STRING, len(value)))
+    out.append(value)
+  elif isinstance(value, list):
+    out.append(struct.pack('<BII', TYPE_TABLE, len(value), 0))
+    for item in value:
+      EncodeValue(out, item)
+  elif isinstance(value, dict):
+    out.append(struct.pack('<BII', TYPE_TABLE, 0, len(value)))
+    for key, item in sorted(value.items()):
+      if not isinstance(key, str):
+        raise ValueError('non-string mapping key: %r' % (key,))
+      out.append(struct.pack('<I', len(key)))
+      out.append(key)
+      EncodeValue(out, item)
+  else:
+    raise ValueError('unsupported value type: %r' % (value,))
+
+
+def main(args):
+  parser = optparse.OptionParser(usage='%prog -o OUTFILE LEVEL_DEF')
+  parser.add_option('-o', '--output', help='output filename')
+  options, filenames = parser.parse_args(args)
+  if not options.output:
+    parser.error('no output file specified')
+  if len(filenames) != 1:
+    parser.error('expected exactly one level def')
+
+  with open(filenames[0]) as level_file:
+    level = yaml.safe_load(level_file)
+
+  out = [struct.pack('<4sII', LEVEL_MAGIC, LEVEL_VERSION, 0)]
+  EncodeValue(out, level)
+
+  with open(options.output, 'wb') as compiled:
+    for part in out:
+      compiled.write(part)
+
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,116 @@
+#!/usr/bin/env python
+# Copyright (c) 2013 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Compile lua sources to stripped bytecode and pack them into a
+single bundle.
+
+The bundle is read at startup by src/lua_bundle.cc, which serves
+individual chunks by offset so no lua text is parsed in release
+builds.  The format is:
+
+  magic    'NTLB' (4 bytes)
+  version  uint32 (little endian)
+  count    uint32
+  count index entries of:
+    name_len uint32
+    name     name_len bytes (module name, e.g. 'drawing')
+    offset   uint32 (from start of file)
+    size     uint32
+  chunk data
+
+Usage: pack_lua.py -o lua.pack [--luac luac] file1.lua file2.lua ...
+"""
+
+import optparse
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+BUNDLE_MAGIC = 'NTLB'
+BUNDLE_VERSION = 1
+
+# Lua 5.1 bytecode embeds the sizes of the compiling host's basic
+# types (lundump.h: version, format, endianness, sizeof(int),
+# sizeof(size_t), sizeof(Instruction), sizeof(lua_Number), integral
+# flag) and lundump rejects chunks whose header does not match the
+# loading VM exactly.  NaCl is ILP32 little-endian with double
+# lua_Numbers, so bytecode from a stock x86-64 luac (size_t == 8)
+# loads on the build machine but is silently rejected inside the nexe
+# and release builds fall back to parsing source.  Check at pack time
+# instead of shipping a broken bundle.
+EXPECTED_HEADER = (0x51, 0, 1, 4, 4, 4, 8, 0)
+HEADER_FIELDS = ('version', 'format', 'endianness', 'sizeof(int)',
+                 'sizeof(size_t)', 'sizeof(Instruction)',
+                 'sizeof(lua_Number)', 'integral flag')
+
+
+def CheckChunkHeader(luac, filename, data):
+  """Verify that compiled bytecode is loadable by the ILP32 NaCl VM."""
+  header = struct.unpack('<8B', data[4:12])
+  if header == EXPECTED_HEADER:
+    return
+  diffs = ['%s=%d (want %d)' % (HEADER_FIELDS[i], header[i],
+                                EXPECTED_HEADER[i])
+           for i in range(len(header)) if header[i] != EXPECTED_HEADER[i]]
+  sys.exit('%s: bytecode for %s is not loadable by the NaCl (ILP32) lua '
+           'VM: %s.\n--luac must point at a luac built with 32-bit '
+           'int/size_t (e.g. a NaCl or -m32 build of lua 5.1).' %
+           (luac, filename, ', '.join(diffs)))
+
+
+def CompileChunk(luac, filename):
+  """Compile a single lua file to stripped bytecode and return it."""
+  fd, outfile = tempfile.mkstemp(suffix='.luac')
+  os.close(fd)
+  try:
+    subprocess.check_call([luac, '-s', '-o', outfile, filename])
+    with open(outfile, 'rb') as compiled:
+      data = compiled.read()
+  finally:
+    os.remove(outfile)
+  CheckChunkHeader(luac, filename, data)
+  return data
+
+
+def main(args):
+  parser = optparse.OptionParser(usage='%prog -o OUTFILE [options] FILES...')
+  parser.add_option('-o', '--output', help='output bundle filename')
+  parser.add_option('--luac', default='luac',
+                    help='lua compiler to use (default: %default)')
+  options, filenames = parser.parse_args(args)
+  if not options.output:
+    parser.error('no output file specified')
+  if not filenames:
+    parser.error('no input files specified')
+
+  chunks = []
+  for filename in filenames:
+    # Chunks are keyed by module name so the runtime loader can serve
+    # require('drawing') as well as dofile-style loads.
+    name = os.path.splitext(os.path.basename(filename))[0]
+    chunks.append((name, CompileChunk(options.luac, filename)))
+
+  index_size = 12 + sum(12 + len(name) for name, _ in chunks)
+  offset = index_size
+  index = [struct.pack('<4sII', BUNDLE_MAGIC, BUNDLE_VERSION, len(chunks))]
+  for name, data in chunks:
+    index.append(struct.pack('<I', len(name)))
+    index.append(name)
+    index.append(struct.pack('<II', offset, len(data)))
+    offset += len(data)
+
+  with open(options.output, 'wb') as bundle:
+    for part in index:
+      bundle.write(part)
+    for _, data in chunks:
+      bundle.write(data)
+
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+# Copyright (c) 2013 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Pack a resource directory into a single indexed archive.
+
+The archive is fetched once at startup by src/resource_pack.cc,
+which then serves all resource lookups from memory instead of
+issuing one HTTP request per file through the NaCl filesystem shim.
+The format is:
+
+  magic    'NTRP' (4 bytes)
+  version  uint32 (little endian)
+  count    uint32
+  count index entries of:
+    path_len uint32
+    path     path_len bytes (relative, forward slashes)
+    offset   uint32 (from start of file)
+    size     uint32
+  file data
+
+Usage: pack_resources.py -o res.pack RESOURCE_DIR
+"""
+
+import optparse
+import os
+import struct
+import sys
+
+PACK_MAGIC = 'NTRP'
+PACK_VERSION = 1
+
+
+def CollectFiles(root):
+  """Return (relative_path, absolute_path) for every file under root."""
+  entries = []
+  for dirpath, _, filenames in os.walk(root):
+    for filename in sorted(filenames):
+      absolute = os.path.join(dirpath, filename)
+      relative = os.path.relpath(absolute, root).replace(os.sep, '/')
+      entries.append((relative, absolute))
+  return sorted(entries)
+
+
+def main(args):
+  parser = optparse.OptionParser(usage='%prog -o OUTFILE RESOURCE_DIR')
+  parser.add_option('-o', '--output', help='output pack filename')
+  options, dirs = parser.parse_args(args)
+  if not options.output:
+    parser.error('no output file specified')
+  if len(dirs) != 1:
+    parser.error('expected exactly one resource directory')
+
+  entries = CollectFiles(dirs[0])
+  if not entries:
+    parser.error('no files found under %s' % dirs[0])
+
+  index_size = 12 + sum(12 + len(path) for path, _ in entries)
+  offset = index_size
+  index = [struct.pack('<4sII', PACK_MAGIC, PACK_VERSION, len(entries))]
+  sizes = []
+  for path, absolute in entries:
+    size = os.path.getsize(absolute)
+    index.append(struct.pack('<I', len(path)))
+    index.append(path)
+    index.append(struct.pack('<II', offset, size))
+    sizes.append(size)
+    offset += size
+
+  with open(options.output, 'wb') as pack:
+    for part in index:
+      pack.write(part)
+    for _, absolute in entries:
+      with open(absolute, 'rb') as resource:
+        pack.write(resource.read())
+
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv[1:]))
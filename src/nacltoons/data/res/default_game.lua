@@ -51,7 +51,9 @@ local function CreateLevelMenu(layer)
     local function LevelSelected(tag)
         local level_number = tag
         util.Log('LevelSelected: ' .. level_number)
-        GameManager:sharedManager():LoadLevel(level_number)
+        -- Load asynchronously so the menu stays responsive while
+        -- level assets are fetched and parsed.
+        GameManager:sharedManager():LoadLevelAsync(level_number)
     end
 
     -- For each level create a menu item and a textual label
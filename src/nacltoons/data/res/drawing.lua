@@ -27,6 +27,13 @@ local drawing = {
 
 drawing.mode = drawing.MODE_FREEHAND
 
+-- When enabled, level sprites that sit at their body's origin are
+-- placed in shared CCSpriteBatchNode's keyed by texture, so a level
+-- renders in one draw call per texture/atlas page rather than one
+-- per sprite.  Disable for games that rely on parenting visible
+-- sprites directly to their physics nodes.
+drawing.sprite_batching = true
+
 -- Brush information (set by SetBrush)
 local brush_tex
 local brush_thickness
@@ -64,6 +71,29 @@ local function b2VecFromLua(luapoint)
     return rtn
 end
 
+--- Get (creating on first use) the shared batch node for a texture.
+-- Batches are children of the level layer and live for the lifetime
+-- of the level (level_obj is rebuilt on every load).
+local function GetSpriteBatch(texture)
+    if not level_obj.sprite_batches then
+        level_obj.sprite_batches = {}
+    end
+    local batch = level_obj.sprite_batches[texture]
+    if not batch then
+        batch = CCSpriteBatchNode:createWithTexture(texture, DEFAULT_BATCH_COUNT)
+        level_obj.layer:addChild(batch, 1)
+        level_obj.sprite_batches[texture] = batch
+    end
+    return batch
+end
+
+--- Load a texture atlas (plist + page image).  Frames registered
+-- here can be referenced from sprite defs with 'frame' instead of
+-- 'image', and all sprites from one page share a single batch node.
+function drawing.LoadAtlas(plist, image)
+    CCSpriteFrameCache:sharedSpriteFrameCache():addSpriteFramesWithFile(plist, image)
+end
+
 local function CreateBrushBatch(parent)
     local node = CCSpriteBatchNode:createWithTexture(brush_tex, DEFAULT_BATCH_COUNT)
     assert(node)
@@ -96,7 +126,10 @@ local function AddShapeToBody(body, shape, sensor)
     return body:CreateFixture(fixture_def)
 end
 
-local function InitPhysicsNode(node, location, dynamic, tag)
+-- interest is an optional collision-interest bitmask for the new
+-- body; contacts are only reported to scripts when the two bodies'
+-- masks intersect (bodies without a mask match everything).
+local function InitPhysicsNode(node, location, dynamic, tag, interest)
     local body_def = b2BodyDef:new_local()
     if dynamic == true then
         body_def.type = b2_dynamicBody
@@ -107,6 +140,9 @@ local function InitPhysicsNode(node, location, dynamic, tag)
     node:setPosition(location)
     node:setTag(tag)
     body:SetUserData(tag)
+    if interest then
+        level_obj.layer:SetBodyInterest(tag, interest)
+    end
     level_obj.layer:addChild(node, 1, tag)
     return body
 end
@@ -203,12 +239,16 @@ function drawing.SetBrush(brush)
 end
 
 --- Create a physics sprite at a given location with a given image
+-- (or atlas frame, see drawing.LoadAtlas).
+--
+-- The created sprite is registered on the def as sprite_def.sprite.
+-- Game scripts must use that field (rather than layer:getChildByTag)
+-- to reach the sprite: when batching is enabled the sprite lives in
+-- a shared per-texture batch node, not in the tagged physics node.
 local function AddSpriteToShape(node, sprite_def, absolute)
     local pos = util.PointFromLua(sprite_def.pos, absolute)
-    util.Log('Create sprite [tag=' .. sprite_def.tag .. ' image=' .. sprite_def.image .. ' absolute=' .. tostring(absolute) .. ']: ' ..
+    util.Log('Create sprite [tag=' .. sprite_def.tag .. ' image=' .. tostring(sprite_def.image or sprite_def.frame) .. ' absolute=' .. tostring(absolute) .. ']: ' ..
         util.PointToString(pos))
-    local image = game_obj.assets[sprite_def.image]
-    local sprite = CCSprite:create(image)
     local rel_pos
     local world_pos
     if absolute then
@@ -218,9 +258,34 @@ local function AddSpriteToShape(node, sprite_def, absolute)
        rel_pos = pos
        world_pos = node:convertToWorldSpace(pos)
     end
+    local body = node:getB2Body()
+    -- Sprites at the body origin can track the body themselves from
+    -- inside the shared per-texture batch node, so the whole level's
+    -- uses of a texture render as a single draw call.
+    local sprite
+    if drawing.sprite_batching and rel_pos.x == 0 and rel_pos.y == 0 then
+        if sprite_def.frame then
+            sprite = CCPhysicsSprite:createWithSpriteFrameName(sprite_def.frame)
+        else
+            sprite = CCPhysicsSprite:create(game_obj.assets[sprite_def.image])
+        end
+        local radius = sprite:getContentSize().height/2
+        sprite:setB2Body(body)
+        sprite:setPTMRatio(util.PTM_RATIO)
+        GetSpriteBatch(sprite:getTexture()):addChild(sprite)
+        AddSphereToBody(body, world_pos, radius, sprite_def.sensor)
+        sprite_def.sprite = sprite
+        return sprite
+    end
+    if sprite_def.frame then
+        sprite = CCSprite:createWithSpriteFrameName(sprite_def.frame)
+    else
+        sprite = CCSprite:create(game_obj.assets[sprite_def.image])
+    end
     sprite:setPosition(rel_pos)
     node:addChild(sprite)
-    AddSphereToBody(node:getB2Body(), world_pos, sprite:boundingBox().size.height/2, sprite_def.sensor)
+    AddSphereToBody(body, world_pos, sprite:boundingBox().size.height/2, sprite_def.sensor)
+    sprite_def.sprite = sprite
     return sprite
 end
 
@@ -256,6 +321,11 @@ function drawing.CreateShape(shape_def)
             for _, child_def in ipairs(shape_def.children) do
                 child_def.tag = shape_def.tag
                 child = AddChildShape(shape, child_def, false)
+                -- Children share the compound's tag, so expose any
+                -- image sprite on the registered (compound) def too.
+                if child_def.sprite then
+                    shape_def.sprite = child_def.sprite
+                end
             end
         end
     elseif shape_def.type == 'line' then
@@ -433,6 +503,24 @@ function drawing.OnTouchMoved(x, y)
     end
 end
 
+--- Batched variant of OnTouchMoved: receives every move point for
+-- the tracked touch since the last frame as a flat (x1, y1, ...)
+-- table.  Freehand drawing consumes each point; the shape modes
+-- rebuild from the start position every move, so only the newest
+-- point matters and the rest are skipped.
+function drawing.OnTouchPolyline(points, count)
+    if count == 0 then
+        return
+    end
+    if drawing.mode == drawing.MODE_FREEHAND then
+        for i = 0, count - 1 do
+            drawing.OnTouchMoved(points[i * 2 + 1], points[i * 2 + 2])
+        end
+    else
+        drawing.OnTouchMoved(points[(count - 1) * 2 + 1], points[count * 2])
+    end
+end
+
 --- Sample OnTouchEnded for drawing-based games.  For bespoke drawing behaviour
 -- clone and modify this code.
 function drawing.OnTouchEnded(x, y)
@@ -114,6 +114,30 @@ function LoadGame(root_dir)
    end
 end
 
+--- Capture the game state built by LoadGame.  The returned snapshot
+-- is held by the C++ GameManager (as a registry ref) and handed back
+-- to RestoreGame on reloads.  A deep copy is taken so later play
+-- cannot mutate the snapshot.
+function SnapshotGame()
+    return {
+        game_obj = util.DeepCopy(game_obj),
+        game_root = game_root,
+    }
+end
+
+--- Reinstall game state from a SnapshotGame capture instead of
+-- re-running the loader chain: the gamedef yaml load, script dofiles,
+-- validation and audio preload are all skipped.  Only StartGame runs
+-- again, to rebuild the initial scene.
+function RestoreGame(snapshot)
+    game_root = snapshot.game_root
+    game_obj = util.DeepCopy(snapshot.game_obj)
+    level_obj = nil
+    if game_obj.script.StartGame then
+        game_obj.script.StartGame()
+    end
+end
+
 local function LevelInit()
     -- level_obj.tag_map maps string tags to integer tags
     -- level_obj.tag_list is simply a list of string tags
@@ -135,13 +159,17 @@ end
 --- Load the given level of the given game
 -- @param layer The level to populate with game objects
 -- @param level_number The level to load
-function LoadLevel(layer, level_number)
+-- @param prefetch When true the level is only being warmed up for a
+--                 later transition: music playback and the
+--                 StartLevel hook are deferred until
+--                 ActivatePrefetchedLevel.
+function LoadLevel(layer, level_number, prefetch)
     Log('loading level ' .. level_number .. ' from ' .. game_obj.filename)
     -- Get level descrition object
     assert(level_number <= #game_obj.levels and level_number > 0,
            'Invalid level number: ' .. level_number)
     local filename = path.join(game_obj.root, game_obj.levels[level_number])
-    level_obj = util.LoadYaml(filename)
+    level_obj = util.LoadLevelDef(filename)
 
     validate.ValidateLevelDef(filename, game_obj, level_obj)
 
@@ -157,7 +185,7 @@ function LoadLevel(layer, level_number)
     drawing.SetBrush(level_obj.brush)
 
     -- Start music playback
-    if game_obj.assets.music then
+    if game_obj.assets.music and not prefetch then
         SimpleAudioEngine:sharedEngine():playBackgroundMusic(game_obj.assets.music, true)
     end
 
@@ -195,6 +223,35 @@ function LoadLevel(layer, level_number)
     end
 
     layer:registerScriptTouchHandler(touch_handler.TouchHandler)
+    if not prefetch then
+        StartLevel(level_number)
+    end
+end
+
+-- The warm level built by PrefetchLevel, waiting to be activated.
+local prefetched = nil
+
+--- Build a level without making it current.  The fully built
+-- level_obj is stashed and the running level's state is restored, so
+-- this is safe to call mid-game; GameManager uses it to warm the
+-- next level's scene while the current one is played.
+function PrefetchLevel(layer, level_number)
+    local saved = level_obj
+    LoadLevel(layer, level_number, true)
+    prefetched = { obj = level_obj, number = level_number }
+    level_obj = saved
+end
+
+--- Make the prefetched level current and run the start hooks that
+-- PrefetchLevel deferred.
+function ActivatePrefetchedLevel()
+    assert(prefetched, 'no prefetched level to activate')
+    level_obj = prefetched.obj
+    local level_number = prefetched.number
+    prefetched = nil
+    if game_obj.assets.music then
+        SimpleAudioEngine:sharedEngine():playBackgroundMusic(game_obj.assets.music, true)
+    end
     StartLevel(level_number)
 end
 
@@ -220,6 +277,13 @@ function LevelComplete()
 end
 
 local function CallCollisionHandler(tag1, tag2, handler_name)
+    -- The level can already be torn down (LevelComplete sets
+    -- level_obj to nil) while buffered contact events are still in
+    -- flight; drop them.
+    if not level_obj then
+        return
+    end
+
     local object1 = level_obj.object_map[tag1]
     local object2 = level_obj.object_map[tag2]
 
@@ -255,6 +319,43 @@ function OnContactEnded(tag1, tag2)
     CallCollisionHandler(tag1, tag2, 'OnContactEnded')
 end
 
+--- Batched contact dispatch.  The C++ LevelLayer buffers contact
+-- events during the world step and delivers them all here once per
+-- frame.  'events' is a preallocated flat array containing a
+-- (tag1, tag2, began) triple for each of the 'count' events; entries
+-- beyond count * 3 are stale data from previous frames.
+function OnContactEvents(events, count)
+    for i = 0, count - 1 do
+        local base = i * 3
+        local handler_name
+        if events[base + 3] then
+            handler_name = 'OnContactBegan'
+        else
+            handler_name = 'OnContactEnded'
+        end
+        CallCollisionHandler(events[base + 1], events[base + 2], handler_name)
+    end
+end
+
+--- Per-frame touch flush.  The C++ LevelLayer calls this once per
+-- frame to deliver the move events coalesced since the last frame
+-- (see touch_handler.FlushTouchMoves).
+function FlushTouchEvents()
+    touch_handler.FlushTouchMoves()
+end
+
+--- Called by GameManager:Restart() before the C++ side rewinds the
+-- box2d world in place.  The game script resets its own level state
+-- (timers, scores, ...) and returns true to accept the fast restart;
+-- returning false (or not defining a handler) falls back to a full
+-- level rebuild.
+function OnLevelReset()
+    if game_obj.script.OnLevelReset and game_obj.script.OnLevelReset() then
+        return 1
+    end
+    return 0
+end
+
 function StartLevel(level_number)
     -- only call handlers if the objects in question have tags
     -- that are known to the currently running level
@@ -78,6 +78,20 @@ function handlers.Update(delta)
     end
 end
 
+--- Game behaviour callback.  Called on restart before the engine
+-- rewinds the box2d world in place.  Reset the level game state and
+-- accept the fast restart unless stars have already been collected
+-- (their sprites are gone, so a full rebuild is needed).
+function handlers.OnLevelReset()
+    local state = level_obj.game_state
+    if next(state.stars_collected) ~= nil then
+        return false
+    end
+    state.goal_reached = false
+    state.time_remaining = 30
+    return true
+end
+
 --- Game behaviour callback.  Called when a level is started/restarted.
 -- This function sets up level-specific game state, and adds any UI
 -- needed for the level.  In this case we add a menu layer to the scene
@@ -118,6 +132,12 @@ function handlers.StartLevel(level_number)
     level_obj.time_display = CCLabelTTF:create("--", FONT_NAME, FONT_SIZE)
     level_obj.layer:addChild(level_obj.time_display)
     PositionTimer(level_obj.time_display)
+
+    -- Warm the next level's scene while this one is played so the
+    -- level transition is near-instant.
+    if level_number < #game_obj.levels then
+        GameManager:sharedManager():PrefetchLevel(level_number + 1)
+    end
 end
 
 --- Remove a shape that was previously draw by this drawing module.
@@ -175,6 +195,12 @@ function handlers.OnTouchMoved(x, y)
     drawing.OnTouchMoved(x, y)
 end
 
+--- Forward a frame's worth of coalesced move points to the default
+-- drawing handler in one call.
+function handlers.OnTouchPolyline(points, count)
+    drawing.OnTouchPolyline(points, count)
+end
+
 --- Forward touch events to default drawing handler.
 function handlers.OnTouchEnded(x, y)
     last_drawn_shape = drawing.OnTouchEnded(x, y)
@@ -205,7 +231,10 @@ function handlers.OnContactBegan(object1, object2)
             if state.stars_collected[i] ~= true then
                 util.Log('star ' .. i .. ' reached')
                 state.stars_collected[i] = true
-                local star = level_obj.layer:getChildByTag(star_tag)
+                -- The sprite may live in a shared batch node when
+                -- sprite batching is on, so reach it through the def
+                -- (see drawing.AddSpriteToShape) rather than by tag.
+                local star = other.sprite or level_obj.layer:getChildByTag(star_tag)
                 local action = CCFadeOut:create(0.5)
                 star:runAction(action);
             end
@@ -221,7 +250,7 @@ function handlers.OnContactBegan(object1, object2)
                 LevelComplete()
             end
 
-            local goal = level_obj.layer:getChildByTag(level_obj.goal_tag)
+            local goal = other.sprite or level_obj.layer:getChildByTag(level_obj.goal_tag)
             local fadeout = CCFadeOut:create(0.5)
             local fadeout_done = CCCallFuncN:create(GoalFadeoutComplete)
             local seq = CCSequence:createWithTwoActions(fadeout, fadeout_done);
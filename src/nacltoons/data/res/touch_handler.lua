@@ -109,15 +109,75 @@ local function OnTouchBegan(x, y, touchid)
     return false
 end
 
+-- Move events buffered between frames, keyed by touchid.  Each entry
+-- holds a flat (x1, y1, x2, y2, ...) point table that is reused
+-- frame to frame so steady-state input does not allocate.  Touch
+-- moves arrive from Pepper far faster than the frame rate on
+-- high-refresh touchscreens; dispatching each one into the drawing
+-- handlers makes drawn lines lag the finger, so they are coalesced
+-- into one polyline delivery per touch per frame.
+local pending_moves = {}
+local have_pending = false
+
 local function OnTouchMoved(x, y, touchid)
     -- ignore touch moves unless the touchid matches the one we are currently tracking
     if touchid == touch_state.touchid then
-        if touch_state.receiver.script.OnTouchMoved then
+        local entry = pending_moves[touchid]
+        if not entry then
+            entry = { points = {}, count = 0 }
+            pending_moves[touchid] = entry
+        end
+        entry.points[entry.count * 2 + 1] = x
+        entry.points[entry.count * 2 + 2] = y
+        entry.count = entry.count + 1
+        have_pending = true
+    end
+end
+
+-- Deliver one touch's buffered polyline to the current receiver.
+-- Receivers that define OnTouchPolyline get the whole point list in
+-- a single call (the table is reused, so handlers must not keep a
+-- reference to it); otherwise each point is replayed through
+-- OnTouchMoved, which still caps dispatch at once per frame.
+local function DispatchMoves(entry)
+    local receiver = touch_state.receiver
+    if not receiver or not receiver.script then
+        return
+    end
+    local script = receiver.script
+    if script.OnTouchPolyline then
+        if touch_state.is_object then
+            script.OnTouchPolyline(receiver, entry.points, entry.count)
+        else
+            script.OnTouchPolyline(entry.points, entry.count)
+        end
+    elseif script.OnTouchMoved then
+        for i = 0, entry.count - 1 do
+            local x = entry.points[i * 2 + 1]
+            local y = entry.points[i * 2 + 2]
             if touch_state.is_object then
-                touch_state.receiver.script.OnTouchMoved(touch_state.receiver, x, y)
+                script.OnTouchMoved(receiver, x, y)
             else
-                touch_state.receiver.script.OnTouchMoved(x, y)
+                script.OnTouchMoved(x, y)
+            end
+        end
+    end
+end
+
+--- Deliver all buffered move events.  Called once per frame from the
+-- native per-frame flush (and before a touch ends, so handlers see
+-- the final points in order).
+function touch_handler.FlushTouchMoves()
+    if not have_pending then
+        return
+    end
+    have_pending = false
+    for touchid, entry in pairs(pending_moves) do
+        if entry.count > 0 then
+            if touchid == touch_state.touchid then
+                DispatchMoves(entry)
             end
+            entry.count = 0
         end
     end
 end
@@ -125,6 +185,8 @@ end
 local function OnTouchEnded(x, y, touchid)
     -- ignore touch ends unless the touchid matches the one we are currently tracking
     if touchid == touch_state.touchid then
+        -- deliver any moves buffered this frame before the end event
+        touch_handler.FlushTouchMoves()
         if touch_state.receiver.script.OnTouchEnded then
             if touch_state.is_object then
                 touch_state.receiver.script.OnTouchEnded(touch_state.receiver, x, y)
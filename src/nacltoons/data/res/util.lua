@@ -28,6 +28,25 @@ function util.Log(arg)
     print('LUA: ' .. tostring(arg))
 end
 
+--- Recursively copy a table, preserving cycles and metatables.
+-- Non-table values (including functions and userdata) are shared by
+-- reference.  Used by the game snapshot/restore path in loader.lua.
+function util.DeepCopy(value, seen)
+    if type(value) ~= 'table' then
+        return value
+    end
+    seen = seen or {}
+    if seen[value] then
+        return seen[value]
+    end
+    local copy = {}
+    seen[value] = copy
+    for k, v in pairs(value) do
+        copy[util.DeepCopy(k, seen)] = util.DeepCopy(v, seen)
+    end
+    return setmetatable(copy, getmetatable(value))
+end
+
 function util.PointToString(point)
     return string.format('%dx%d', point.x, point.y)
 end
@@ -63,6 +82,21 @@ function util.LoadYaml(filename)
     return yaml.load(filedata)
 end
 
+--- Load a level def, preferring the compiled binary form.
+-- Published builds ship levels pre-compiled by build/compile_level.py
+-- (filename plus a 'b' suffix, e.g. level1.defb) which the native
+-- loader decodes directly into a table; falls back to parsing the
+-- YAML source in dev mode.
+function util.LoadLevelDef(filename)
+    if load_level_def then
+        local level = load_level_def(filename .. 'b')
+        if level then
+            return level
+        end
+    end
+    return util.LoadYaml(filename)
+end
+
 --- Escape string for inclusion in yaml output.  Normal strings
 -- that contain no special characters don't even need quoting in
 -- in yaml.  This function adds quotes and escape chars as needed.
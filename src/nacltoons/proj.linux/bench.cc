@@ -0,0 +1,195 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Headless benchmark for the physics and lua-binding hot paths.
+// Builds without CCDirector or GL so it can run on any machine
+// (including the buildbots) and produce stable, comparable numbers.
+//
+// The world is configured exactly like LevelLayer::InitPhysics and
+// filled with a synthetic pile of dynamic boxes; the lua state gets
+// the same LuaBox2D + fast-path bindings the game installs.  Each
+// measurement is repeated over several trials and reported as
+// mean +/- stddev so regressions stand out from noise.
+//
+// Usage: bench [body_count] [trials]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Box2D/Box2D.h"
+#include "LuaBox2D.h"
+#include "LuaBox2DFastPath.h"
+
+extern "C" {
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+#include "tolua++.h"
+}
+
+namespace {
+
+const int kDefaultBodyCount = 300;
+const int kDefaultTrials = 10;
+const int kStepsPerTrial = 600;  // 10 simulated seconds
+const int kVelocityIterations = 8;
+const int kPositionIterations = 1;
+
+double Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Counts contacts the same way LevelLayer's listener sees them.
+class ContactCounter : public b2ContactListener {
+ public:
+  ContactCounter() : contacts(0) {}
+  virtual void BeginContact(b2Contact* contact) { contacts++; }
+  long contacts;
+};
+
+// Build the synthetic scene: a static ground box with |body_count|
+// dynamic unit boxes stacked above it.
+b2World* CreateWorld(int body_count, ContactCounter* counter) {
+  b2Vec2 gravity(0.0f, -9.8f);
+  b2World* world = new b2World(gravity);
+  world->SetAllowSleeping(true);
+  world->SetContinuousPhysics(true);
+  world->SetContactListener(counter);
+
+  b2BodyDef ground_def;
+  b2Body* ground = world->CreateBody(&ground_def);
+  b2PolygonShape ground_shape;
+  ground_shape.SetAsBox(50.0f, 1.0f);
+  ground->CreateFixture(&ground_shape, 0.0f);
+
+  b2PolygonShape box_shape;
+  box_shape.SetAsBox(0.5f, 0.5f);
+  for (int i = 0; i < body_count; i++) {
+    b2BodyDef body_def;
+    body_def.type = b2_dynamicBody;
+    // Lay the boxes out in a loose grid so they collide and settle.
+    body_def.position.Set((i % 20) * 1.1f - 11.0f, 2.0f + (i / 20) * 1.1f);
+    b2Body* body = world->CreateBody(&body_def);
+    body->CreateFixture(&box_shape, 1.0f);
+  }
+  return world;
+}
+
+struct Stats {
+  double mean;
+  double stddev;
+};
+
+Stats Summarize(const double* samples, int count) {
+  Stats stats = {0, 0};
+  for (int i = 0; i < count; i++)
+    stats.mean += samples[i];
+  stats.mean /= count;
+  for (int i = 0; i < count; i++) {
+    double d = samples[i] - stats.mean;
+    stats.stddev += d * d;
+  }
+  stats.stddev = sqrt(stats.stddev / count);
+  return stats;
+}
+
+void Report(const char* name, const Stats& stats, const char* unit) {
+  printf("%-24s %12.1f +/- %8.1f %s\n", name, stats.mean, stats.stddev, unit);
+}
+
+// Measure raw stepping throughput and contact rate.
+void BenchWorldStep(int body_count, int trials) {
+  double steps_per_sec[64];
+  double contacts_per_sec[64];
+  for (int trial = 0; trial < trials; trial++) {
+    ContactCounter counter;
+    b2World* world = CreateWorld(body_count, &counter);
+    double start = Now();
+    for (int i = 0; i < kStepsPerTrial; i++)
+      world->Step(1.0f / 60, kVelocityIterations, kPositionIterations);
+    double elapsed = Now() - start;
+    steps_per_sec[trial] = kStepsPerTrial / elapsed;
+    contacts_per_sec[trial] = counter.contacts / elapsed;
+    delete world;
+  }
+  Report("world step", Summarize(steps_per_sec, trials), "steps/s");
+  Report("contacts", Summarize(contacts_per_sec, trials), "contacts/s");
+}
+
+// Measure the cost of crossing the lua boundary through the
+// generated bindings vs the fast path, using the hottest setter.
+void BenchLuaCrossing(int trials) {
+  lua_State* state = luaL_newstate();
+  luaL_openlibs(state);
+  tolua_LuaBox2D_open(state);
+
+  b2Vec2 gravity(0.0f, -9.8f);
+  b2World world(gravity);
+  b2BodyDef body_def;
+  body_def.type = b2_dynamicBody;
+  b2Body* body = world.CreateBody(&body_def);
+
+  const char* chunk =
+      "local body, n = ...\n"
+      "local vec = b2Vec2:new_local(1, 2)\n"
+      "for i = 1, n do body:SetLinearVelocity(vec) end\n";
+  const int kCalls = 100000;
+
+  // Generated tolua++ path.
+  double slow_calls_per_sec[64];
+  for (int trial = 0; trial < trials; trial++) {
+    luaL_loadstring(state, chunk);
+    tolua_pushusertype(state, body, "b2Body");
+    lua_pushinteger(state, kCalls);
+    double start = Now();
+    if (lua_pcall(state, 2, 0, 0)) {
+      fprintf(stderr, "lua error: %s\n", lua_tostring(state, -1));
+      exit(1);
+    }
+    slow_calls_per_sec[trial] = kCalls / (Now() - start);
+  }
+  Report("tolua++ crossing", Summarize(slow_calls_per_sec, trials),
+         "calls/s");
+
+  // Fast path (numbers instead of boxed vectors).
+  tolua_LuaBox2D_fastpath_open(state);
+  const char* fast_chunk =
+      "local body, n = ...\n"
+      "for i = 1, n do body:SetLinearVelocity(1, 2) end\n";
+  double fast_calls_per_sec[64];
+  for (int trial = 0; trial < trials; trial++) {
+    luaL_loadstring(state, fast_chunk);
+    tolua_pushusertype(state, body, "b2Body");
+    lua_pushinteger(state, kCalls);
+    double start = Now();
+    if (lua_pcall(state, 2, 0, 0)) {
+      fprintf(stderr, "lua error: %s\n", lua_tostring(state, -1));
+      exit(1);
+    }
+    fast_calls_per_sec[trial] = kCalls / (Now() - start);
+  }
+  Report("fast-path crossing", Summarize(fast_calls_per_sec, trials),
+         "calls/s");
+
+  lua_close(state);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int body_count = argc > 1 ? atoi(argv[1]) : kDefaultBodyCount;
+  int trials = argc > 2 ? atoi(argv[2]) : kDefaultTrials;
+  if (trials > 64)
+    trials = 64;
+
+  printf("nacltoons bench: %d bodies, %d trials, %d steps/trial\n",
+         body_count, trials, kStepsPerTrial);
+  BenchWorldStep(body_count, trials);
+  BenchLuaCrossing(trials);
+  return 0;
+}
@@ -16,14 +16,39 @@
 #include <AL/alc.h>
 
 #include "app_delegate.h"
+#include "frame_profiler.h"
 
 USING_NS_CC;
 AppDelegate g_app;
 
+namespace {
+
+CocosPepperInstance* g_instance = NULL;
+
+void PostProfileOnMainThread(void* user_data, int32_t result) {
+  std::string* json = static_cast<std::string*>(user_data);
+  if (g_instance)
+    g_instance->PostMessage(pp::Var(*json));
+  delete json;
+}
+
+// FrameProfiler post function.  Called from the cocos thread, so the
+// actual PostMessage is bounced to the pepper main thread.
+void PostProfileMessage(const char* json) {
+  pp::Module::Get()->core()->CallOnMainThread(
+      0, pp::CompletionCallback(PostProfileOnMainThread,
+                                new std::string(json)));
+}
+
+}  // namespace
+
 void* cocos_main(void* arg) {
   CocosPepperInstance* instance = (CocosPepperInstance*)arg;
   fprintf(stderr, "in cocos_main\n");
 
+  g_instance = instance;
+  FrameProfiler::sharedProfiler()->set_post_message_func(PostProfileMessage);
+
   // Any application that uses OpenAL on NaCl needs to call this
   // before starting OpenAL.
   alSetPpapiInfo(instance->pp_instance(),
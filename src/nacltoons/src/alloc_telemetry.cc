@@ -0,0 +1,359 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "alloc_telemetry.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+extern "C" {
+#include "lua.h"
+#include "lauxlib.h"
+}
+
+namespace {
+
+const char* kTagNames[ALLOC_TAG_COUNT] = {
+  "default",
+  "sprite",
+  "physics",
+  "lua",
+};
+
+// Pool size classes: 16, 32, ..., 256 bytes.  Anything larger goes to
+// malloc; the hot sites this is aimed at (sprite objects, binding
+// userdata, lua tables) all fall well under the cap.
+const size_t kPoolStep = 16;
+const size_t kPoolMaxSize = 256;
+const int kPoolClassCount = (int)(kPoolMaxSize / kPoolStep);
+
+// Pool blocks are carved out of fixed-size slabs that are never
+// returned to the system, so recycled blocks stop touching malloc
+// entirely.
+const size_t kPoolSlabSize = 16 * 1024;
+const int kMaxSlabs = 64;
+
+/**
+ * Header prepended to every tracked block.  The union with a double
+ * keeps the payload aligned for any scalar type, matching malloc.
+ */
+union BlockHeader {
+  struct {
+    unsigned int size;
+    short tag;
+    short pool_class;  // size class index, or -1 for plain malloc
+  } info;
+  double align;
+};
+
+// The live counters are signed: the lua hook is installed on an
+// already-running state, so blocks allocated before the hook are
+// recorded on free but never on alloc and the lua tag drifts below
+// its true value (possibly below zero early on).  Signed counters
+// keep that drift from wrapping into garbage; the report clamps at
+// zero when printing.
+struct TagCounters {
+  volatile int live_bytes;
+  volatile int live_blocks;
+  volatile unsigned int allocs;  // drained each report interval
+  int peak_bytes;
+};
+
+struct Slab {
+  char* begin;
+  char* end;
+};
+
+// All module state is POD and zero-initialized, so allocations made
+// during static initialization (before any of our own initializers
+// could have run) are handled correctly.
+TagCounters s_counters[ALLOC_TAG_COUNT];
+
+void* s_pool_free[kPoolClassCount];
+pthread_mutex_t s_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+bool s_pools_enabled = false;
+
+Slab s_slabs[kMaxSlabs];
+volatile int s_slab_count = 0;
+unsigned int s_slab_bytes = 0;
+
+// Original allocator of the hooked lua state.
+lua_Alloc s_lua_next_alloc = NULL;
+void* s_lua_next_ud = NULL;
+
+pthread_key_t s_tag_key;
+pthread_once_t s_tag_once = PTHREAD_ONCE_INIT;
+
+void InitTagKey() {
+  pthread_key_create(&s_tag_key, NULL);
+}
+
+AllocTag CurrentTag() {
+  pthread_once(&s_tag_once, InitTagKey);
+  return (AllocTag)(intptr_t)pthread_getspecific(s_tag_key);
+}
+
+void RecordAlloc(AllocTag tag, size_t size) {
+  TagCounters& counters = s_counters[tag];
+  int live = __sync_add_and_fetch(&counters.live_bytes, (int)size);
+  __sync_fetch_and_add(&counters.live_blocks, 1);
+  __sync_fetch_and_add(&counters.allocs, 1);
+  // Racy peak update; a lost race undercounts by one sample, which is
+  // fine for telemetry.
+  if (live > counters.peak_bytes)
+    counters.peak_bytes = live;
+}
+
+void RecordFree(AllocTag tag, size_t size) {
+  TagCounters& counters = s_counters[tag];
+  __sync_fetch_and_sub(&counters.live_bytes, (int)size);
+  __sync_fetch_and_sub(&counters.live_blocks, 1);
+}
+
+int SizeClass(size_t size) {
+  if (size == 0)
+    size = 1;
+  return (int)((size + kPoolStep - 1) / kPoolStep) - 1;
+}
+
+// Carve a new slab into blocks of the given class and push them onto
+// its free list.  Called with the pool mutex held.
+void RefillPool(int pool_class) {
+  if (s_slab_count >= kMaxSlabs)
+    return;
+  char* slab = (char*)malloc(kPoolSlabSize);
+  if (!slab)
+    return;
+  size_t block_bytes =
+      sizeof(BlockHeader) + (size_t)(pool_class + 1) * kPoolStep;
+  for (size_t offset = 0; offset + block_bytes <= kPoolSlabSize;
+       offset += block_bytes) {
+    BlockHeader* header = (BlockHeader*)(slab + offset);
+    *(void**)(header + 1) = s_pool_free[pool_class];
+    s_pool_free[pool_class] = header;
+  }
+  s_slabs[s_slab_count].begin = slab;
+  s_slabs[s_slab_count].end = slab + kPoolSlabSize;
+  s_slab_bytes += (unsigned int)kPoolSlabSize;
+  // Publish the entry before bumping the count so lock-free PoolOwns
+  // readers never see an uninitialized range.
+  __sync_synchronize();
+  s_slab_count++;
+}
+
+// Whether |payload| points into one of our slabs.  Used by the lua
+// hook to tell pooled blocks (which carry a header) apart from blocks
+// owned by the state's original allocator.
+bool PoolOwns(void* payload) {
+  char* header = (char*)payload - sizeof(BlockHeader);
+  int count = s_slab_count;
+  for (int i = 0; i < count; i++) {
+    if (header >= s_slabs[i].begin && header < s_slabs[i].end)
+      return true;
+  }
+  return false;
+}
+
+// Allocate from the pools only; returns NULL when the class is
+// exhausted and no new slab could be created.
+void* PoolAlloc(size_t size, AllocTag tag) {
+  int pool_class = SizeClass(size);
+  pthread_mutex_lock(&s_pool_mutex);
+  if (!s_pool_free[pool_class])
+    RefillPool(pool_class);
+  BlockHeader* header = (BlockHeader*)s_pool_free[pool_class];
+  if (header)
+    s_pool_free[pool_class] = *(void**)(header + 1);
+  pthread_mutex_unlock(&s_pool_mutex);
+  if (!header)
+    return NULL;
+  header->info.size = (unsigned int)size;
+  header->info.tag = (short)tag;
+  header->info.pool_class = (short)pool_class;
+  RecordAlloc(tag, size);
+  return header + 1;
+}
+
+// Allocate a tracked block: pooled when enabled and small enough,
+// malloc-with-header otherwise.
+void* TaggedAlloc(size_t size, AllocTag tag) {
+  if (s_pools_enabled && size <= kPoolMaxSize) {
+    void* payload = PoolAlloc(size, tag);
+    if (payload)
+      return payload;
+  }
+  BlockHeader* header = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+  if (!header)
+    return NULL;
+  header->info.size = (unsigned int)size;
+  header->info.tag = (short)tag;
+  header->info.pool_class = -1;
+  RecordAlloc(tag, size);
+  return header + 1;
+}
+
+// Free a block allocated by TaggedAlloc/PoolAlloc.
+void TaggedFree(void* payload) {
+  BlockHeader* header = (BlockHeader*)payload - 1;
+  RecordFree((AllocTag)header->info.tag, header->info.size);
+  if (header->info.pool_class >= 0) {
+    pthread_mutex_lock(&s_pool_mutex);
+    *(void**)(header + 1) = s_pool_free[header->info.pool_class];
+    s_pool_free[header->info.pool_class] = header;
+    pthread_mutex_unlock(&s_pool_mutex);
+  } else {
+    free(header);
+  }
+}
+
+// lua_Alloc wrapper.  The hook is installed on an already-running
+// state, so live blocks owned by the original allocator must keep
+// flowing back to it; only blocks this wrapper itself pooled (decided
+// by slab membership) carry a header.  Large allocations are always
+// delegated, so delegated blocks never have headers.
+void* LuaAlloc(void* ud, void* ptr, size_t osize, size_t nsize) {
+  (void)ud;
+  bool pooled = ptr && PoolOwns(ptr);
+
+  if (nsize == 0) {
+    if (pooled) {
+      TaggedFree(ptr);
+    } else if (ptr) {
+      RecordFree(ALLOC_TAG_LUA, osize);
+      s_lua_next_alloc(s_lua_next_ud, ptr, osize, 0);
+    }
+    return NULL;
+  }
+
+  if (!ptr) {
+    if (s_pools_enabled && nsize <= kPoolMaxSize) {
+      void* fresh = PoolAlloc(nsize, ALLOC_TAG_LUA);
+      if (fresh)
+        return fresh;
+    }
+    void* fresh = s_lua_next_alloc(s_lua_next_ud, NULL, osize, nsize);
+    if (fresh)
+      RecordAlloc(ALLOC_TAG_LUA, nsize);
+    return fresh;
+  }
+
+  // Resize.  When neither side involves the pools the original
+  // allocator can realloc in place; otherwise allocate the new block,
+  // copy, and release the old one through whichever path owns it.
+  bool pool_new = s_pools_enabled && nsize <= kPoolMaxSize;
+  if (!pooled && !pool_new) {
+    void* fresh = s_lua_next_alloc(s_lua_next_ud, ptr, osize, nsize);
+    if (fresh) {
+      RecordFree(ALLOC_TAG_LUA, osize);
+      RecordAlloc(ALLOC_TAG_LUA, nsize);
+    }
+    return fresh;
+  }
+
+  void* fresh = NULL;
+  if (pool_new)
+    fresh = PoolAlloc(nsize, ALLOC_TAG_LUA);
+  if (!fresh) {
+    fresh = s_lua_next_alloc(s_lua_next_ud, NULL, 0, nsize);
+    if (fresh)
+      RecordAlloc(ALLOC_TAG_LUA, nsize);
+  }
+  if (!fresh)
+    return NULL;
+  memcpy(fresh, ptr, osize < nsize ? osize : nsize);
+  if (pooled) {
+    TaggedFree(ptr);
+  } else {
+    RecordFree(ALLOC_TAG_LUA, osize);
+    s_lua_next_alloc(s_lua_next_ud, ptr, osize, 0);
+  }
+  return fresh;
+}
+
+int SetAllocPoolsEnabledLua(lua_State* state) {
+  AllocTelemetrySetPoolsEnabled(lua_toboolean(state, 1) != 0);
+  return 0;
+}
+
+}  // namespace
+
+AllocTag AllocTelemetrySetTag(AllocTag tag) {
+  pthread_once(&s_tag_once, InitTagKey);
+  AllocTag previous = (AllocTag)(intptr_t)pthread_getspecific(s_tag_key);
+  pthread_setspecific(s_tag_key, (void*)(intptr_t)tag);
+  return previous;
+}
+
+void AllocTelemetryInstallLuaHook(lua_State* state) {
+  s_lua_next_alloc = lua_getallocf(state, &s_lua_next_ud);
+  lua_setallocf(state, LuaAlloc, NULL);
+}
+
+int luaopen_alloc_telemetry(lua_State* state) {
+  lua_register(state, "SetAllocPoolsEnabled", SetAllocPoolsEnabledLua);
+  return 0;
+}
+
+void AllocTelemetrySetPoolsEnabled(bool enabled) {
+  s_pools_enabled = enabled;
+}
+
+bool AllocTelemetryPoolsEnabled() {
+  return s_pools_enabled;
+}
+
+int AllocTelemetryAppendReport(char* buffer, int size) {
+  int pos = snprintf(buffer, size, ",\"alloc\":{\"pools\":%d,\"slab_kb\":%u",
+                     s_pools_enabled ? 1 : 0, s_slab_bytes / 1024);
+  for (int i = 0; i < ALLOC_TAG_COUNT; i++) {
+    TagCounters& counters = s_counters[i];
+    unsigned int allocs = counters.allocs;
+    __sync_fetch_and_sub(&counters.allocs, allocs);
+    if (pos >= size)
+      break;
+    // Clamp at zero: pre-hook lua blocks are freed through the hook
+    // without a matching alloc record, so the live counters can sit
+    // below their true value (see TagCounters).
+    int live_bytes = counters.live_bytes > 0 ? counters.live_bytes : 0;
+    int live_blocks = counters.live_blocks > 0 ? counters.live_blocks : 0;
+    int peak_bytes = counters.peak_bytes > 0 ? counters.peak_bytes : 0;
+    pos += snprintf(buffer + pos, size - pos,
+                    ",\"%s\":{\"live_kb\":%d,\"blocks\":%d,\"allocs\":%u,"
+                    "\"peak_kb\":%d}",
+                    kTagNames[i], live_bytes / 1024,
+                    live_blocks, allocs, peak_bytes / 1024);
+  }
+  if (pos < size)
+    pos += snprintf(buffer + pos, size - pos, "}");
+  return pos;
+}
+
+// Global operator new/delete overrides.  Everything linked into the
+// module (cocos included, which is built from source) allocates
+// through these, so CCPhysicsSprite creation and the rest of the node
+// churn are both counted and, when the pools are enabled, served from
+// the slabs.  The newlib build runs without exceptions, so a failed
+// allocation returns NULL like malloc.
+void* operator new(size_t size) throw(std::bad_alloc) {
+  return TaggedAlloc(size, CurrentTag());
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc) {
+  return TaggedAlloc(size, CurrentTag());
+}
+
+void operator delete(void* ptr) throw() {
+  if (ptr)
+    TaggedFree(ptr);
+}
+
+void operator delete[](void* ptr) throw() {
+  if (ptr)
+    TaggedFree(ptr);
+}
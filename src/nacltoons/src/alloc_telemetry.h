@@ -0,0 +1,81 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef ALLOC_TELEMETRY_H_
+#define ALLOC_TELEMETRY_H_
+
+/**
+ * Tagged allocation telemetry for the module heap.
+ *
+ * The newlib build gives us no visibility into heap behaviour, so this
+ * module takes over the two allocation paths we can reach: global
+ * operator new/delete (cocos nodes, sprites, our own containers) and
+ * the lua allocator (VM objects plus tolua binding userdata).  Every
+ * tracked block carries a small header recording its size and the tag
+ * active when it was allocated; per-tag live byte/block counts,
+ * allocation rates and high-water marks are appended to the
+ * FrameProfiler JSON report so the embedding page sees heap trends
+ * alongside frame budgets.  Raw malloc callers (image decoding inside
+ * cocos, Box2D's block allocator) are not intercepted.
+ *
+ * On top of the counters, SetAllocPoolsEnabled (also exposed to lua)
+ * turns on size-class pool allocators for small blocks.  Pooled blocks
+ * are carved from slabs that are never returned to the system, so
+ * steady-state churn -- sprite creation and binding userdata being the
+ * hottest sites -- stops exercising malloc/free and fragmenting the
+ * heap.  Pools are off by default so the counters can A/B them.
+ *
+ * Usage:
+ *   { ScopedAllocTag tag(ALLOC_TAG_SPRITE); BuildLevel(); }
+ */
+
+#include <stddef.h>
+
+enum AllocTag {
+  ALLOC_TAG_DEFAULT = 0,
+  ALLOC_TAG_SPRITE,   // scene construction and node churn
+  ALLOC_TAG_PHYSICS,  // physics thread bookkeeping
+  ALLOC_TAG_LUA,      // lua VM, including tolua userdata
+  ALLOC_TAG_COUNT,
+};
+
+struct lua_State;
+
+// Set the calling thread's current allocation tag, returning the
+// previous one.  Prefer ScopedAllocTag below.
+AllocTag AllocTelemetrySetTag(AllocTag tag);
+
+// Route the given lua state's allocations through the telemetry layer.
+// Blocks allocated before the hook was installed keep using the
+// state's original allocator; only new small blocks are ever pooled.
+void AllocTelemetryInstallLuaHook(lua_State* state);
+
+// Register the global SetAllocPoolsEnabled(bool) lua function.
+int luaopen_alloc_telemetry(lua_State* state);
+
+// Enable or disable the size-class pools.  Blocks already pooled stay
+// pooled (and are recycled) after a disable.
+void AllocTelemetrySetPoolsEnabled(bool enabled);
+bool AllocTelemetryPoolsEnabled();
+
+// Append an "alloc" section to a JSON report being assembled in
+// |buffer| (called by FrameProfiler::ReportIfDue).  Returns the number
+// of characters written.  Per-interval allocation counts are drained
+// by each call; live and peak figures are instantaneous.
+int AllocTelemetryAppendReport(char* buffer, int size);
+
+/**
+ * Tags every allocation made in the enclosing scope (on this thread)
+ * so the telemetry attributes it to the given subsystem.
+ */
+class ScopedAllocTag {
+ public:
+  explicit ScopedAllocTag(AllocTag tag)
+      : previous_(AllocTelemetrySetTag(tag)) {}
+  ~ScopedAllocTag() { AllocTelemetrySetTag(previous_); }
+
+ private:
+  AllocTag previous_;
+};
+
+#endif  // ALLOC_TELEMETRY_H_
@@ -5,9 +5,16 @@
 
 #include "CCLuaEngine.h"
 #include "LuaBox2D.h"
+#include "LuaBox2DFastPath.h"
 #include "LuaCocos2dExtensions.h"
 #include "lua_level_layer.h"
+#include "alloc_telemetry.h"
 #include "game_manager.h"
+#include "level_def.h"
+#include "lua_bundle.h"
+#include "lua_gc_pacer.h"
+#include "lua_lazy_bindings.h"
+#include "resource_pack.h"
 
 extern "C" {
 LUALIB_API int luaopen_yaml(lua_State *L);
@@ -15,6 +22,34 @@ LUALIB_API int luaopen_yaml(lua_State *L);
 
 USING_NS_CC;
 
+namespace {
+
+// Box2D and its hand-tuned fast path glue open together: the fast
+// path overrides methods the generated bindings must define first.
+int OpenBox2D(lua_State* state) {
+  tolua_LuaBox2D_open(state);
+  tolua_LuaBox2D_fastpath_open(state);
+  return 0;
+}
+
+// Globals that trigger materialization of each lazy module.  Only the
+// names our lua code reads directly need to be listed; everything
+// else in a module is reached through these (or through usertypes
+// pushed from C++, which call LuaLazyEnsure explicitly).
+const char* const kBox2DTriggers[] = {
+  "b2Vec2", "b2World", "b2BodyDef", "b2FixtureDef", "b2PolygonShape",
+  "b2CircleShape", "b2EdgeShape", "b2RevoluteJointDef",
+  "b2_staticBody", "b2_kinematicBody", "b2_dynamicBody", NULL
+};
+const char* const kLevelLayerTriggers[] = {
+  "LevelLayer", "GameManager", NULL
+};
+const char* const kExtensionsTriggers[] = {
+  "CCPhysicsNode", "CCPhysicsSprite", NULL
+};
+
+}  // namespace
+
 bool AppDelegate::applicationDidFinishLaunching() {
   CCEGLView* view = CCEGLView::sharedOpenGLView();
 
@@ -37,30 +72,72 @@ bool AppDelegate::applicationDidFinishLaunching() {
 
   CCScriptEngineManager::sharedManager()->setScriptEngine(engine);
 
-  // Add custom lua bindings on top of what cocos2dx provides
+  // Add custom lua bindings on top of what cocos2dx provides.  The
+  // tolua modules (box2d in particular) are expensive to register, so
+  // they are installed lazily and only materialize when the running
+  // game first touches them (see lua_lazy_bindings.h).
   CCLuaStack* stack = engine->getLuaStack();
   lua_State* lua_state = stack->getLuaState();
   assert(lua_state);
-  // add box2D bindings
-  tolua_LuaBox2D_open(lua_state);
-  // add LevelLayer bindings
-  tolua_level_layer_open(lua_state);
-  // add cocos2dx extensions bindings
-  tolua_extensions_open(lua_state);
-  // add yaml bindings
-  luaopen_yaml(lua_state);
+  LuaLazyRegister(lua_state, "LuaBox2D", OpenBox2D, kBox2DTriggers);
+  LuaLazyRegister(lua_state, "level_layer", tolua_level_layer_open,
+                  kLevelLayerTriggers);
+  LuaLazyRegister(lua_state, "extensions", tolua_extensions_open,
+                  kExtensionsTriggers);
+  // yaml is reached via require, so lazy loading only needs a
+  // package.preload entry
+  lua_getglobal(lua_state, "package");
+  lua_getfield(lua_state, -1, "preload");
+  lua_pushcfunction(lua_state, luaopen_yaml);
+  lua_setfield(lua_state, -2, "yaml");
+  lua_pop(lua_state, 2);
+  // add the compiled binary level loader
+  luaopen_level_def(lua_state);
+  // count lua allocations (VM objects and tolua userdata) in the heap
+  // telemetry, and let game scripts opt in to the small-block pools
+  // via SetAllocPoolsEnabled
+  AllocTelemetryInstallLuaHook(lua_state);
+  luaopen_alloc_telemetry(lua_state);
+  // take over GC scheduling: collection now runs in a budgeted step
+  // after each frame's draw instead of whenever an allocation
+  // crosses the collector's threshold mid-frame
+  LuaGCPacer::sharedPacer()->Attach(lua_state);
 
   CCFileUtils* utils = CCFileUtils::sharedFileUtils();
+
+  // Fetch the packed resource archive (one round trip) and serve all
+  // further resource lookups from memory.  Builds published without a
+  // pack fall through to loose per-file fetches.
+  ResourcePack* pack = ResourcePack::sharedPack();
+  std::string pack_path = utils->fullPathForFilename("res.pack");
+  if (pack->Load(pack_path.c_str()))
+    pack->Mount("/res-pack");
+
   std::string path = utils->fullPathForFilename("loader.lua");
 
   // add the location of the lua file to the search path
   engine->addSearchPath(path.substr(0, path.find_last_of("/")).c_str());
 
-  // execute loader file
-  int rtn = engine->executeScriptFile(path.c_str());
-  assert(!rtn);
-  if (rtn)
-    return false;
+  bool bundle_loaded = false;
+#ifndef COCOS2D_DEBUG
+  // In release builds load the engine scripts from the precompiled
+  // bytecode bundle (see build/pack_lua.py) so startup never parses
+  // lua source.  Debug builds always run from source.
+  LuaBundle* bundle = LuaBundle::sharedBundle();
+  std::string bundle_path = utils->fullPathForFilename("lua.pack");
+  if (bundle->Load(bundle_path.c_str())) {
+    bundle->InstallLoader(lua_state);
+    bundle_loaded = bundle->ExecuteChunk(lua_state, "loader") == 0;
+  }
+#endif
+
+  if (!bundle_loaded) {
+    // execute loader file from source
+    int rtn = engine->executeScriptFile(path.c_str());
+    assert(!rtn);
+    if (rtn)
+      return false;
+  }
 
   GameManager::sharedManager()->LoadGame("sample_game");
   return true;
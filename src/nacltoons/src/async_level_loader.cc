@@ -0,0 +1,140 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "async_level_loader.h"
+
+#include <dirent.h>
+#include <stdio.h>
+
+#include "game_manager.h"
+#include "CCLuaEngine.h"
+
+extern "C" {
+#include "lua.h"
+}
+
+AsyncLevelLoader::AsyncLevelLoader()
+    : level_number_(0),
+      stage_(STAGE_PREFETCH),
+      thread_started_(false),
+      prefetch_done_(false) {
+}
+
+AsyncLevelLoader::~AsyncLevelLoader() {
+  // The prefetch thread reads this object, so it must be joined
+  // before destruction.
+  if (thread_started_)
+    pthread_join(prefetch_thread_, NULL);
+}
+
+AsyncLevelLoader* AsyncLevelLoader::create(int level_number) {
+  AsyncLevelLoader* loader = new AsyncLevelLoader();
+  loader->level_number_ = level_number;
+  if (loader->init()) {
+    loader->autorelease();
+    return loader;
+  }
+  delete loader;
+  return NULL;
+}
+
+bool AsyncLevelLoader::init() {
+  scheduleUpdate();
+  return true;
+}
+
+void AsyncLevelLoader::NotifyProgress(const char* stage, float fraction) {
+  CCScriptEngineManager* manager = CCScriptEngineManager::sharedManager();
+  CCLuaEngine* engine = (CCLuaEngine*)manager->getScriptEngine();
+  CCLuaStack* lua_stack = engine->getLuaStack();
+  lua_State* state = lua_stack->getLuaState();
+
+  lua_getglobal(state, "OnLoadProgress");
+  bool is_func = lua_isfunction(state, -1);
+  lua_pop(state, 1);
+  if (!is_func)
+    return;
+
+  lua_stack->pushString(stage);
+  lua_stack->pushFloat(fraction);
+  lua_stack->executeFunctionByName("OnLoadProgress", 2);
+}
+
+void AsyncLevelLoader::PrefetchDir(const std::string& path) {
+  DIR* dir = opendir(path.c_str());
+  if (!dir)
+    return;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.')
+      continue;
+    std::string child = path + "/" + entry->d_name;
+    FILE* file = fopen(child.c_str(), "rb");
+    if (!file) {
+      // Not a regular file; recurse into it as a directory.
+      PrefetchDir(child);
+      continue;
+    }
+    // Read and discard the contents.  On nacl_io this pulls the file
+    // through the HTTP mount and into the cache.
+    char buffer[4096];
+    while (fread(buffer, 1, sizeof(buffer), file) == sizeof(buffer))
+      continue;
+    fclose(file);
+  }
+  closedir(dir);
+}
+
+void* AsyncLevelLoader::PrefetchThread(void* arg) {
+  AsyncLevelLoader* loader = static_cast<AsyncLevelLoader*>(arg);
+  loader->PrefetchDir(loader->game_root_);
+  loader->prefetch_done_ = true;
+  return NULL;
+}
+
+void AsyncLevelLoader::update(float dt) {
+  GameManager* manager = GameManager::sharedManager();
+  switch (stage_) {
+    case STAGE_PREFETCH:
+      // Resolve the game root here on the main thread; CCFileUtils
+      // is not safe to call from the prefetch thread.
+      game_root_ = CCFileUtils::sharedFileUtils()->fullPathForFilename(
+          manager->game_folder());
+      if (pthread_create(&prefetch_thread_, NULL, PrefetchThread, this)) {
+        // Couldn't spawn the thread; fall through to a cold load.
+        prefetch_done_ = true;
+      } else {
+        thread_started_ = true;
+      }
+      stage_ = STAGE_WAIT_PREFETCH;
+      NotifyProgress("prefetch", 0.25f);
+      break;
+    case STAGE_WAIT_PREFETCH:
+      if (!prefetch_done_)
+        break;
+      if (thread_started_) {
+        pthread_join(prefetch_thread_, NULL);
+        thread_started_ = false;
+      }
+      stage_ = STAGE_SCRIPTS;
+      NotifyProgress("scripts", 0.5f);
+      break;
+    case STAGE_SCRIPTS:
+      // Run the lua level-load flow.  Caches are warm so this stage
+      // no longer stalls on fetches.
+      manager->CreateLevel();
+      stage_ = STAGE_ATTACH;
+      NotifyProgress("attach", 0.75f);
+      break;
+    case STAGE_ATTACH:
+      manager->FinishAsyncLoad();
+      NotifyProgress("done", 1.0f);
+      stage_ = STAGE_DONE;
+      unscheduleUpdate();
+      removeFromParentAndCleanup(true);
+      break;
+    case STAGE_DONE:
+      break;
+  }
+}
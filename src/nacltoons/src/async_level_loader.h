@@ -0,0 +1,69 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef ASYNC_LEVEL_LOADER_H_
+#define ASYNC_LEVEL_LOADER_H_
+
+#include <pthread.h>
+#include <string>
+
+#include "cocos2d.h"
+
+USING_NS_CC;
+
+/**
+ * Drives an asynchronous level load.  Added as a child of the
+ * loading scene by GameManager::LoadLevelAsync, it advances through
+ * the load one stage per frame so the GL thread never stalls for the
+ * whole load:
+ *
+ *   1. prefetch - a background pthread reads every file under the
+ *      game root, warming the nacl_io cache so the synchronous lua
+ *      load that follows doesn't block on HTTP round trips.
+ *   2. scripts  - the lua LoadLevel flow runs on the GL thread (the
+ *      lua state is not thread safe) against warm caches.
+ *   3. attach   - GameManager attaches the finished level to the
+ *      scene and removes the loading overlay.
+ *
+ * After each stage the lua global OnLoadProgress(stage, fraction) is
+ * called if the game defines it.
+ */
+class AsyncLevelLoader : public CCNode {
+ public:
+  AsyncLevelLoader();
+  ~AsyncLevelLoader();
+
+  static AsyncLevelLoader* create(int level_number);
+
+  virtual bool init();
+  virtual void update(float dt);
+
+ private:
+  enum LoadStage {
+    STAGE_PREFETCH,
+    STAGE_WAIT_PREFETCH,
+    STAGE_SCRIPTS,
+    STAGE_ATTACH,
+    STAGE_DONE,
+  };
+
+  static void* PrefetchThread(void* arg);
+
+  // Read every file under |path| (recursively), discarding the data.
+  void PrefetchDir(const std::string& path);
+
+  // Report progress to the lua OnLoadProgress handler, if defined.
+  void NotifyProgress(const char* stage, float fraction);
+
+  int level_number_;
+  LoadStage stage_;
+  pthread_t prefetch_thread_;
+  bool thread_started_;
+  volatile bool prefetch_done_;
+
+  // Filesystem root of the current game, resolved on the main thread
+  // before the prefetch thread starts.
+  std::string game_root_;
+};
+
+#endif  // ASYNC_LEVEL_LOADER_H_
@@ -0,0 +1,153 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "batched_debug_draw.h"
+
+USING_NS_CC;
+
+namespace {
+
+// Number of segments used to approximate circles, matching the
+// Box2DTestBed renderer.
+const int kCircleSegments = 16;
+
+ccColor4F MakeColor(const b2Color& color, float alpha) {
+  ccColor4F result = { color.r, color.g, color.b, alpha };
+  return result;
+}
+
+}  // namespace
+
+BatchedDebugDraw::BatchedDebugDraw(float32 ratio) : ratio_(ratio) {
+  // Per-vertex color shader so fills and outlines of different
+  // colors can share one batch.
+  program_ = CCShaderCache::sharedShaderCache()->programForKey(
+      kCCShader_PositionColor);
+}
+
+void BatchedDebugDraw::AddTriangle(const b2Vec2& p1, const b2Vec2& p2,
+                                   const b2Vec2& p3,
+                                   const ccColor4F& color) {
+  DebugVertex vertex;
+  vertex.color = color;
+  vertex.x = p1.x * ratio_;
+  vertex.y = p1.y * ratio_;
+  triangles_.push_back(vertex);
+  vertex.x = p2.x * ratio_;
+  vertex.y = p2.y * ratio_;
+  triangles_.push_back(vertex);
+  vertex.x = p3.x * ratio_;
+  vertex.y = p3.y * ratio_;
+  triangles_.push_back(vertex);
+}
+
+void BatchedDebugDraw::AddLine(const b2Vec2& p1, const b2Vec2& p2,
+                               const ccColor4F& color) {
+  DebugVertex vertex;
+  vertex.color = color;
+  vertex.x = p1.x * ratio_;
+  vertex.y = p1.y * ratio_;
+  lines_.push_back(vertex);
+  vertex.x = p2.x * ratio_;
+  vertex.y = p2.y * ratio_;
+  lines_.push_back(vertex);
+}
+
+void BatchedDebugDraw::DrawPolygon(const b2Vec2* vertices,
+                                   int32 vertex_count,
+                                   const b2Color& color) {
+  ccColor4F outline = MakeColor(color, 1.0f);
+  for (int32 i = 0; i < vertex_count; i++)
+    AddLine(vertices[i], vertices[(i + 1) % vertex_count], outline);
+}
+
+void BatchedDebugDraw::DrawSolidPolygon(const b2Vec2* vertices,
+                                        int32 vertex_count,
+                                        const b2Color& color) {
+  // Half-intensity fill plus full-intensity outline, like the
+  // testbed renderer.
+  b2Color fill_color(color.r * 0.5f, color.g * 0.5f, color.b * 0.5f);
+  ccColor4F fill = MakeColor(fill_color, 0.5f);
+  for (int32 i = 1; i < vertex_count - 1; i++)
+    AddTriangle(vertices[0], vertices[i], vertices[i + 1], fill);
+  DrawPolygon(vertices, vertex_count, color);
+}
+
+void BatchedDebugDraw::DrawCircle(const b2Vec2& center, float32 radius,
+                                  const b2Color& color) {
+  ccColor4F outline = MakeColor(color, 1.0f);
+  const float32 increment = 2.0f * b2_pi / kCircleSegments;
+  float32 theta = 0.0f;
+  for (int i = 0; i < kCircleSegments; i++) {
+    b2Vec2 p1 = center + radius * b2Vec2(cosf(theta), sinf(theta));
+    theta += increment;
+    b2Vec2 p2 = center + radius * b2Vec2(cosf(theta), sinf(theta));
+    AddLine(p1, p2, outline);
+  }
+}
+
+void BatchedDebugDraw::DrawSolidCircle(const b2Vec2& center, float32 radius,
+                                       const b2Vec2& axis,
+                                       const b2Color& color) {
+  b2Color fill_color(color.r * 0.5f, color.g * 0.5f, color.b * 0.5f);
+  ccColor4F fill = MakeColor(fill_color, 0.5f);
+  const float32 increment = 2.0f * b2_pi / kCircleSegments;
+  float32 theta = 0.0f;
+  for (int i = 0; i < kCircleSegments; i++) {
+    b2Vec2 p1 = center + radius * b2Vec2(cosf(theta), sinf(theta));
+    theta += increment;
+    b2Vec2 p2 = center + radius * b2Vec2(cosf(theta), sinf(theta));
+    AddTriangle(center, p1, p2, fill);
+  }
+  DrawCircle(center, radius, color);
+  // Orientation marker.
+  AddLine(center, center + radius * axis, MakeColor(color, 1.0f));
+}
+
+void BatchedDebugDraw::DrawSegment(const b2Vec2& p1, const b2Vec2& p2,
+                                   const b2Color& color) {
+  AddLine(p1, p2, MakeColor(color, 1.0f));
+}
+
+void BatchedDebugDraw::DrawTransform(const b2Transform& xf) {
+  const float32 kAxisScale = 0.4f;
+  b2Vec2 p1 = xf.p;
+  ccColor4F red = { 1.0f, 0.0f, 0.0f, 1.0f };
+  AddLine(p1, p1 + kAxisScale * xf.q.GetXAxis(), red);
+  ccColor4F green = { 0.0f, 1.0f, 0.0f, 1.0f };
+  AddLine(p1, p1 + kAxisScale * xf.q.GetYAxis(), green);
+}
+
+void BatchedDebugDraw::Flush() {
+  if (triangles_.empty() && lines_.empty())
+    return;
+
+  program_->use();
+  program_->setUniformsForBuiltins();
+  ccGLEnableVertexAttribs(kCCVertexAttribFlag_Position |
+                          kCCVertexAttribFlag_Color);
+
+  if (!triangles_.empty()) {
+    glVertexAttribPointer(kCCVertexAttrib_Position, 2, GL_FLOAT, GL_FALSE,
+                          sizeof(DebugVertex), &triangles_[0].x);
+    glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(DebugVertex), &triangles_[0].color);
+    glDrawArrays(GL_TRIANGLES, 0, triangles_.size());
+    CC_INCREMENT_GL_DRAWS(1);
+  }
+
+  if (!lines_.empty()) {
+    glVertexAttribPointer(kCCVertexAttrib_Position, 2, GL_FLOAT, GL_FALSE,
+                          sizeof(DebugVertex), &lines_[0].x);
+    glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(DebugVertex), &lines_[0].color);
+    glDrawArrays(GL_LINES, 0, lines_.size());
+    CC_INCREMENT_GL_DRAWS(1);
+  }
+
+  // clear() keeps the capacity so steady-state frames don't allocate.
+  triangles_.clear();
+  lines_.clear();
+  CHECK_GL_ERROR_DEBUG();
+}
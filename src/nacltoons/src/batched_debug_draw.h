@@ -0,0 +1,70 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef BATCHED_DEBUG_DRAW_H_
+#define BATCHED_DEBUG_DRAW_H_
+
+#include <vector>
+
+#include "cocos2d.h"
+#include "Box2D/Box2D.h"
+
+/**
+ * A single vertex in the accumulated debug geometry: position in
+ * pixels plus a per-vertex color so everything can be drawn in one
+ * batch.
+ */
+struct DebugVertex {
+  float x;
+  float y;
+  cocos2d::ccColor4F color;
+};
+
+typedef std::vector<DebugVertex> DebugVertexList;
+
+/**
+ * Batched replacement for the Box2DTestBed GLESDebugDraw.  The b2Draw
+ * callbacks only append vertices to two arrays (triangles for fills,
+ * lines for outlines/joints); Flush() then draws the whole world in
+ * two GL calls.  This keeps the debug overlay interactive on levels
+ * with hundreds of fixtures where one draw call per shape does not.
+ */
+class BatchedDebugDraw : public b2Draw {
+ public:
+  explicit BatchedDebugDraw(float32 ratio);
+
+  // b2Draw interface; these accumulate geometry only.
+  virtual void DrawPolygon(const b2Vec2* vertices, int32 vertex_count,
+                           const b2Color& color);
+  virtual void DrawSolidPolygon(const b2Vec2* vertices, int32 vertex_count,
+                                const b2Color& color);
+  virtual void DrawCircle(const b2Vec2& center, float32 radius,
+                          const b2Color& color);
+  virtual void DrawSolidCircle(const b2Vec2& center, float32 radius,
+                               const b2Vec2& axis, const b2Color& color);
+  virtual void DrawSegment(const b2Vec2& p1, const b2Vec2& p2,
+                           const b2Color& color);
+  virtual void DrawTransform(const b2Transform& xf);
+
+  // Draw everything accumulated since the last flush and reset the
+  // buffers (capacity is retained between frames).  Call once per
+  // frame after b2World::DrawDebugData.
+  void Flush();
+
+ private:
+  void AddTriangle(const b2Vec2& p1, const b2Vec2& p2, const b2Vec2& p3,
+                   const cocos2d::ccColor4F& color);
+  void AddLine(const b2Vec2& p1, const b2Vec2& p2,
+               const cocos2d::ccColor4F& color);
+
+  // Pixels per box2d meter.
+  float32 ratio_;
+
+  cocos2d::CCGLProgram* program_;
+
+  // Accumulated geometry, one list per primitive type.
+  DebugVertexList triangles_;
+  DebugVertexList lines_;
+};
+
+#endif  // BATCHED_DEBUG_DRAW_H_
@@ -0,0 +1,120 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "frame_profiler.h"
+
+#include "alloc_telemetry.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+namespace {
+
+const char* kCategoryNames[PROFILE_CATEGORY_COUNT] = {
+  "world_step",
+  "contact_dispatch",
+  "draw",
+  "snapshot_apply",
+  "level_load",
+  "lua_gc",
+};
+
+}  // namespace
+
+const double FrameProfiler::kReportInterval = 5.0;
+
+FrameProfiler* FrameProfiler::sharedProfiler() {
+  static FrameProfiler* shared_profiler = NULL;
+  if (!shared_profiler)
+    shared_profiler = new FrameProfiler();
+  return shared_profiler;
+}
+
+FrameProfiler::FrameProfiler()
+    : write_index_(0),
+      read_index_(0),
+      binding_calls_(0),
+      last_report_time_(Now()),
+      post_message_func_(NULL) {
+  memset(ring_, 0, sizeof(ring_));
+}
+
+double FrameProfiler::Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void FrameProfiler::AddSample(ProfileCategory category, double seconds) {
+  // Lock-free multi-producer write: claim a slot, then fill it in.
+  // A reader racing with the fill can observe a torn sample; that is
+  // acceptable for telemetry and keeps this path to a handful of
+  // instructions.
+  unsigned int index = __sync_fetch_and_add(&write_index_, 1);
+  Sample& sample = ring_[index & (kRingSize - 1)];
+  sample.category = category;
+  sample.duration = (float)seconds;
+}
+
+void FrameProfiler::CountBindingCall() {
+  __sync_fetch_and_add(&binding_calls_, 1);
+}
+
+void FrameProfiler::ReportIfDue() {
+  if (!post_message_func_)
+    return;
+  double now = Now();
+  double interval = now - last_report_time_;
+  if (interval < kReportInterval)
+    return;
+  last_report_time_ = now;
+
+  // Aggregate all samples written since the last report (clamped to
+  // ring capacity if the reader fell behind).
+  unsigned int end = write_index_;
+  unsigned int start = read_index_;
+  if (end - start > kRingSize)
+    start = end - kRingSize;
+  read_index_ = end;
+
+  int counts[PROFILE_CATEGORY_COUNT] = {0};
+  double totals[PROFILE_CATEGORY_COUNT] = {0};
+  double maxes[PROFILE_CATEGORY_COUNT] = {0};
+  for (unsigned int i = start; i != end; i++) {
+    const Sample& sample = ring_[i & (kRingSize - 1)];
+    if (sample.category < 0 || sample.category >= PROFILE_CATEGORY_COUNT)
+      continue;
+    counts[sample.category]++;
+    totals[sample.category] += sample.duration;
+    if (sample.duration > maxes[sample.category])
+      maxes[sample.category] = sample.duration;
+  }
+
+  unsigned int binding_calls = binding_calls_;
+  __sync_fetch_and_sub(&binding_calls_, binding_calls);
+
+  char json[2048];
+  int pos = snprintf(json, sizeof(json),
+                     "{\"profile\":{\"interval_s\":%.2f,"
+                     "\"binding_calls\":%u", interval, binding_calls);
+  for (int i = 0; i < PROFILE_CATEGORY_COUNT; i++) {
+    pos += snprintf(json + pos, sizeof(json) - pos,
+                    ",\"%s\":{\"count\":%d,\"total_ms\":%.3f,"
+                    "\"max_ms\":%.3f}",
+                    kCategoryNames[i], counts[i], totals[i] * 1000,
+                    maxes[i] * 1000);
+    if (pos >= (int)sizeof(json))
+      return;  // summary doesn't fit; drop it rather than truncate
+  }
+
+  // Heap telemetry rides along in the same report (see
+  // alloc_telemetry.h).
+  pos += AllocTelemetryAppendReport(json + pos, sizeof(json) - pos);
+  if (pos >= (int)sizeof(json))
+    return;
+  snprintf(json + pos, sizeof(json) - pos, "}}");
+
+  post_message_func_(json);
+}
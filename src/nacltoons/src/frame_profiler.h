@@ -0,0 +1,93 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef FRAME_PROFILER_H_
+#define FRAME_PROFILER_H_
+
+/**
+ * Lightweight hot-path instrumentation.  Scoped timers write samples
+ * into a fixed-size lock-free ring buffer (safe to use from both the
+ * render thread and the physics thread), and once per reporting
+ * interval the accumulated samples are summarized as a JSON string
+ * and handed to a platform-provided post function — on NaCl this
+ * forwards to the Pepper messaging interface so the embedding page
+ * can collect frame budgets from the field.
+ *
+ * Usage:
+ *   { ScopedTimer timer(PROFILE_WORLD_STEP); world->Step(...); }
+ */
+
+enum ProfileCategory {
+  PROFILE_WORLD_STEP = 0,
+  PROFILE_CONTACT_DISPATCH,
+  PROFILE_DRAW,
+  PROFILE_SNAPSHOT_APPLY,
+  PROFILE_LEVEL_LOAD,
+  PROFILE_LUA_GC,
+  PROFILE_CATEGORY_COUNT,
+};
+
+class FrameProfiler {
+ public:
+  // Callback used to deliver JSON summaries to the embedder.
+  typedef void (*PostMessageFunc)(const char* json);
+
+  static FrameProfiler* sharedProfiler();
+
+  // Record a timed sample for the given category.  Thread safe.
+  void AddSample(ProfileCategory category, double seconds);
+
+  // Count one lua binding call.  Thread safe.
+  void CountBindingCall();
+
+  // Current monotonic time in seconds.
+  static double Now();
+
+  void set_post_message_func(PostMessageFunc func) {
+    post_message_func_ = func;
+  }
+
+  // Summarize and post accumulated samples if the reporting interval
+  // has elapsed.  Called once per frame from the render thread; does
+  // nothing when no post function is registered.
+  void ReportIfDue();
+
+ private:
+  FrameProfiler();
+
+  struct Sample {
+    int category;
+    float duration;
+  };
+
+  // Ring size must be a power of two.
+  static const unsigned int kRingSize = 4096;
+  static const double kReportInterval;  // seconds
+
+  Sample ring_[kRingSize];
+  volatile unsigned int write_index_;
+  unsigned int read_index_;
+  volatile unsigned int binding_calls_;
+  double last_report_time_;
+  PostMessageFunc post_message_func_;
+};
+
+/**
+ * Times the enclosing scope and records the result under the given
+ * category.
+ */
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(ProfileCategory category)
+      : category_(category), start_(FrameProfiler::Now()) {}
+  ~ScopedTimer() {
+    FrameProfiler::sharedProfiler()->AddSample(
+        category_, FrameProfiler::Now() - start_);
+  }
+
+ private:
+  ProfileCategory category_;
+  double start_;
+};
+
+#endif  // FRAME_PROFILER_H_
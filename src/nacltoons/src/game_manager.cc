@@ -2,9 +2,17 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 #include "game_manager.h"
+#include "alloc_telemetry.h"
+#include "async_level_loader.h"
+#include "frame_profiler.h"
 #include "level_layer.h"
 #include "CCLuaEngine.h"
 
+extern "C" {
+#include "lua.h"
+#include "lauxlib.h"
+}
+
 USING_NS_CC;
 
 GameManager* GameManager::sharedManager()
@@ -17,6 +25,8 @@ GameManager* GameManager::sharedManager()
 
 void GameManager::CreateLevel()
 {
+  ScopedTimer timer(PROFILE_LEVEL_LOAD);
+  ScopedAllocTag alloc_tag(ALLOC_TAG_SPRITE);
   LevelLayer* level = LevelLayer::create();
   scene_->addChild(level, 1, TAG_LAYER_LEVEL);
   level->LoadLevel(level_number_);
@@ -24,17 +34,114 @@ void GameManager::CreateLevel()
 
 void GameManager::Restart()
 {
+  // Fast path: rewind the running level in place, reusing all of its
+  // body and sprite allocations.  Falls back to a full rebuild when
+  // the game doesn't support in-place reset.
+  LevelLayer* level =
+      static_cast<LevelLayer*>(scene_->getChildByTag(TAG_LAYER_LEVEL));
+  if (level && level->ResetLevel())
+    return;
+
   scene_->removeAllChildren();
   // Recreate the level
   CreateLevel();
 }
 
+void GameManager::PrefetchLevel(int level_number)
+{
+  if (prefetched_scene_ && prefetched_level_number_ == level_number)
+    return;
+  DropPrefetchedScene();
+
+  // Build the whole scene now, on the GL thread so script execution
+  // and texture uploads are safe.  The level's music and StartLevel
+  // hook are deferred until the scene is activated (see
+  // PrefetchLevel/ActivatePrefetchedLevel in loader.lua).
+  ScopedTimer timer(PROFILE_LEVEL_LOAD);
+  ScopedAllocTag alloc_tag(ALLOC_TAG_SPRITE);
+  CCScene* scene = CCScene::create();
+  LevelLayer* level = LevelLayer::create();
+  scene->addChild(level, 1, TAG_LAYER_LEVEL);
+  if (!level->PrefetchLoad(level_number))
+    return;
+  scene->retain();
+  prefetched_scene_ = scene;
+  prefetched_level_number_ = level_number;
+}
+
+void GameManager::DropPrefetchedScene()
+{
+  if (!prefetched_scene_)
+    return;
+  prefetched_scene_->release();
+  prefetched_scene_ = NULL;
+}
+
+void GameManager::LoadLevelAsync(int level_number)
+{
+  CCDirector* director = CCDirector::sharedDirector();
+
+  // If this level was prefetched there is nothing to load
+  // asynchronously: LoadLevel swaps the warm scene in near-instantly.
+  if (prefetched_scene_ && prefetched_level_number_ == level_number) {
+    LoadLevel(level_number);
+    return;
+  }
+  // A prefetched scene for a different level is no use to anyone now;
+  // release it before building the new one on top of it.
+  DropPrefetchedScene();
+
+  level_number_ = level_number;
+  scene_ = CCScene::create();
+
+  // Push the (empty) scene immediately with just a loading message;
+  // the AsyncLevelLoader child fills in the level over the following
+  // frames.
+  CCSize visible_size = director->getVisibleSize();
+  CCLayer* loading = CCLayerColor::create(ccc4(0, 0x8F, 0xD8, 0xD8));
+  CCLabelTTF* label = CCLabelTTF::create("Loading...", "Arial.ttf", 24);
+  label->setPosition(ccp(visible_size.width/2, visible_size.height/2));
+  loading->addChild(label);
+  scene_->addChild(loading, 1, TAG_LAYER_LOADING);
+  scene_->addChild(AsyncLevelLoader::create(level_number));
+
+  director->setDepthTest(true);
+  CCTransitionScene* transition =
+      CCTransitionPageTurn::create(1.0f, scene_, false);
+  director->pushScene(transition);
+}
+
+void GameManager::FinishAsyncLoad()
+{
+  scene_->removeChildByTag(TAG_LAYER_LOADING, true);
+}
+
 bool GameManager::LoadGame(const char* folder) {
   CCScriptEngineManager* manager = CCScriptEngineManager::sharedManager();
   CCLuaEngine* engine = (CCLuaEngine*)manager->getScriptEngine();
   assert(engine);
   CCLuaStack* lua_stack = engine->getLuaStack();
   assert(lua_stack);
+  lua_State* state = lua_stack->getLuaState();
+
+  // Fast path for reloading the same game (play <-> edit mode
+  // switches, full restarts): reinstall the lua state captured after
+  // the first load instead of re-running the whole loader chain.
+  if (game_snapshot_ref_ && game_folder_ == folder) {
+    CCLog("restoring game state from snapshot");
+    lua_getglobal(state, "RestoreGame");
+    lua_rawgeti(state, LUA_REGISTRYINDEX, game_snapshot_ref_);
+    if (lua_pcall(state, 1, 0, 0) == 0)
+      return true;
+    // A failed restore leaves the snapshot suspect; drop it and fall
+    // through to a full load.
+    CCLog("LUA ERROR: %s", lua_tostring(state, -1));
+    lua_pop(state, 1);
+    luaL_unref(state, LUA_REGISTRYINDEX, game_snapshot_ref_);
+    game_snapshot_ref_ = 0;
+  }
+
+  game_folder_ = folder;
 
   CCLog("running LoadGame on stack: %p", lua_stack);
   lua_stack->pushString(folder);
@@ -46,14 +153,76 @@ bool GameManager::LoadGame(const char* folder) {
   if (rtn != 1)
     return false;
 
+  // Capture the fully built game state so later reloads of the same
+  // game can restore it without touching the loader chain.  The game
+  // is already loaded at this point, so a failed capture just means
+  // reloads take the slow path.
+  lua_getglobal(state, "SnapshotGame");
+  if (lua_pcall(state, 0, 1, 0) == 0) {
+    game_snapshot_ref_ = luaL_ref(state, LUA_REGISTRYINDEX);
+  } else {
+    CCLog("LUA ERROR: %s", lua_tostring(state, -1));
+    lua_pop(state, 1);
+  }
+
+  // Rasterize the game-over labels now, while we are already inside
+  // the loading hitch, instead of at the moment a level completes.
+  CreateGameOverOverlay();
+
   return true;
 }
 
+void GameManager::CreateGameOverOverlay()
+{
+  if (gameover_overlay_)
+    return;
+
+  CCSize visible_size = CCDirector::sharedDirector()->getVisibleSize();
+  CCPoint center = ccp(visible_size.width/2, visible_size.height/2);
+
+  gameover_overlay_ = CCLayerColor::create(ccc4(0x0, 0x0, 0x0, 0x0));
+  gameover_overlay_->retain();
+
+  // Creating both labels up front runs the software TTF rasterizer
+  // and uploads the resulting textures; GameOver then just toggles
+  // visibility.
+  success_label_ = CCLabelTTF::create("Success!", "Arial.ttf", 24);
+  success_label_->setPosition(center);
+  success_label_->setVisible(false);
+  gameover_overlay_->addChild(success_label_);
+
+  failure_label_ = CCLabelTTF::create("Failure!", "Arial.ttf", 24);
+  failure_label_->setPosition(center);
+  failure_label_->setVisible(false);
+  gameover_overlay_->addChild(failure_label_);
+
+  // CCActionInterval resets its elapsed time in startWithTarget, so a
+  // retained action can be re-run each time the overlay is shown.
+  gameover_fadein_ = CCFadeTo::create(0.5f, 0x7F);
+  gameover_fadein_->retain();
+}
+
 void GameManager::LoadLevel(int level_number)
 {
   CCDirector* director = CCDirector::sharedDirector();
   CCTransitionScene* transition;
   level_number_ = level_number;
+
+  // Use the warm scene if this level was prefetched: everything is
+  // already built so the swap is near-instant and skips the page
+  // turn.
+  if (prefetched_scene_ && prefetched_level_number_ == level_number) {
+    scene_ = prefetched_scene_;
+    prefetched_scene_ = NULL;
+    LevelLayer* level =
+        static_cast<LevelLayer*>(scene_->getChildByTag(TAG_LAYER_LEVEL));
+    level->ActivatePrefetched();
+    director->setDepthTest(true);
+    director->pushScene(scene_);
+    scene_->release();
+    return;
+  }
+
   scene_ = CCScene::create();
 
   CreateLevel();
@@ -64,17 +233,18 @@ void GameManager::LoadLevel(int level_number)
 }
 
 void GameManager::GameOver(bool success) {
-  CCSize visible_size = CCDirector::sharedDirector()->getVisibleSize();
-
-  // Create a black overlay layer with success/failure message
-  CCLayer* overlay = CCLayerColor::create(ccc4(0x0, 0x0, 0x0, 0x0));
-  const char* text = success ? "Success!" : "Failure!";
-  CCLabelTTF* label = CCLabelTTF::create(text, "Arial.ttf", 24);
-  label->setPosition(ccp(visible_size.width/2, visible_size.height/2));
-  overlay->addChild(label);
-  scene_->addChild(overlay, 2, TAG_LAYER_OVERLAY);
+  // Show the precreated black overlay with the success/failure
+  // message.  Everything (layer, labels, fade action) was built at
+  // game load, so nothing is allocated or rasterized here.
+  assert(gameover_overlay_);
+  if (gameover_overlay_->getParent())
+    gameover_overlay_->removeFromParentAndCleanup(false);
+  success_label_->setVisible(success);
+  failure_label_->setVisible(!success);
+  gameover_overlay_->setOpacity(0x0);
+  scene_->addChild(gameover_overlay_, 2, TAG_LAYER_OVERLAY);
 
-  // Face the overlay layer into to 50%
-  CCActionInterval* fadein = CCFadeTo::create(0.5f, 0x7F);
-  overlay->runAction(fadein);
+  // Fade the overlay layer in to 50%
+  gameover_overlay_->stopAllActions();
+  gameover_overlay_->runAction(gameover_fadein_);
 }
@@ -14,6 +14,7 @@
 enum ObjectTags {
   TAG_LAYER_LEVEL = 100,
   TAG_LAYER_OVERLAY = 102,
+  TAG_LAYER_LOADING = 103,
 };
 
 USING_NS_CC;
@@ -27,13 +28,78 @@ class GameManager {
   void Restart();
   void GameOver(bool success);
   void LoadLevel(int level_number);
+
+  // Build the given level's scene now (scripts executed, bodies
+  // created, textures uploaded) and keep it warm, so a later
+  // LoadLevel for the same number swaps to the already-built scene
+  // with near-zero latency.  Typically called by game scripts right
+  // after a level starts to warm the next one.
+  void PrefetchLevel(int level_number);
+
+  // Asynchronous variant of LoadLevel.  Pushes a scene containing
+  // only a loading overlay right away and hands the actual load to
+  // an AsyncLevelLoader, which prefetches assets on a background
+  // thread and attaches the level once everything is warm.  See
+  // async_level_loader.h for the stage breakdown.
+  void LoadLevelAsync(int level_number);
+
+  // Called by AsyncLevelLoader when the level has been created to
+  // remove the loading overlay.
+  void FinishAsyncLoad();
+
+  // Create the level layer for the current level in the current
+  // scene.  Called either synchronously from LoadLevel/Restart or
+  // from the async loading pipeline.
+  void CreateLevel();
+
   static GameManager* sharedManager();
   bool LoadGame(const char* folder);
+
+  // Folder of the currently loaded game (as passed to LoadGame).
+  const char* game_folder() { return game_folder_.c_str(); }
  private:
-  void CreateLevel();
-  GameManager() : level_number_(0), scene_(NULL) {}
+  GameManager()
+      : level_number_(0),
+        scene_(NULL),
+        prefetched_scene_(NULL),
+        prefetched_level_number_(0),
+        gameover_overlay_(NULL),
+        success_label_(NULL),
+        failure_label_(NULL),
+        gameover_fadein_(NULL),
+        game_snapshot_ref_(0) {}
+
+  // Release any prefetched scene that was never activated.
+  void DropPrefetchedScene();
+
+  // Build the game-over overlay (layer, both result labels and the
+  // fade action) once, at game load, so GameOver() itself allocates
+  // nothing.  CCLabelTTF rasterizes through the slow software TTF
+  // path, which would otherwise hitch right at level completion.
+  void CreateGameOverOverlay();
+
   int level_number_;
   CCScene* scene_;
+
+  // Warm scene built by PrefetchLevel, retained until it is either
+  // activated by LoadLevel or replaced.
+  CCScene* prefetched_scene_;
+  int prefetched_level_number_;
+
+  // Precreated game-over overlay, reused across levels (see
+  // CreateGameOverOverlay).
+  CCLayerColor* gameover_overlay_;
+  CCLabelTTF* success_label_;
+  CCLabelTTF* failure_label_;
+  CCActionInterval* gameover_fadein_;
+
+  // Registry ref to the lua game snapshot captured after LoadGame
+  // (see SnapshotGame/RestoreGame in loader.lua), or 0 if no game has
+  // been loaded yet.  Reloading the same game restores from this
+  // instead of re-running the loader chain.
+  int game_snapshot_ref_;
+
+  std::string game_folder_;
 };
 
 #endif  // GAME_MANAGER_H_
@@ -0,0 +1,158 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "level_def.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "lauxlib.h"
+}
+
+namespace {
+
+const char kLevelMagic[] = "NTLD";
+const unsigned int kLevelVersion = 1;
+
+// Value tags, matching build/compile_level.py.
+enum {
+  TYPE_NIL = 0,
+  TYPE_FALSE = 1,
+  TYPE_TRUE = 2,
+  TYPE_NUMBER = 3,
+  TYPE_STRING = 4,
+  TYPE_TABLE = 5,
+};
+
+// Read a little-endian uint32, advancing |pos|.  Returns false on
+// truncation.
+bool ReadU32(const char** pos, const char* end, unsigned int* value) {
+  if (end - *pos < 4)
+    return false;
+  memcpy(value, *pos, 4);
+  *pos += 4;
+  return true;
+}
+
+// Decode one value onto the lua stack, advancing |pos|.  Returns
+// false (with the stack unchanged) on malformed input.
+bool DecodeValue(lua_State* state, const char** pos, const char* end) {
+  if (*pos >= end)
+    return false;
+  unsigned char type = **pos;
+  (*pos)++;
+  switch (type) {
+    case TYPE_NIL:
+      lua_pushnil(state);
+      return true;
+    case TYPE_FALSE:
+      lua_pushboolean(state, 0);
+      return true;
+    case TYPE_TRUE:
+      lua_pushboolean(state, 1);
+      return true;
+    case TYPE_NUMBER: {
+      if (end - *pos < 8)
+        return false;
+      double number;
+      memcpy(&number, *pos, 8);
+      *pos += 8;
+      lua_pushnumber(state, number);
+      return true;
+    }
+    case TYPE_STRING: {
+      unsigned int length;
+      if (!ReadU32(pos, end, &length) || (size_t)(end - *pos) < length)
+        return false;
+      lua_pushlstring(state, *pos, length);
+      *pos += length;
+      return true;
+    }
+    case TYPE_TABLE: {
+      unsigned int array_count;
+      unsigned int hash_count;
+      if (!ReadU32(pos, end, &array_count) ||
+          !ReadU32(pos, end, &hash_count))
+        return false;
+      lua_createtable(state, array_count, hash_count);
+      for (unsigned int i = 0; i < array_count; i++) {
+        if (!DecodeValue(state, pos, end)) {
+          lua_pop(state, 1);
+          return false;
+        }
+        lua_rawseti(state, -2, i + 1);
+      }
+      for (unsigned int i = 0; i < hash_count; i++) {
+        unsigned int key_length;
+        if (!ReadU32(pos, end, &key_length) ||
+            (size_t)(end - *pos) < key_length) {
+          lua_pop(state, 1);
+          return false;
+        }
+        lua_pushlstring(state, *pos, key_length);
+        *pos += key_length;
+        if (!DecodeValue(state, pos, end)) {
+          lua_pop(state, 2);
+          return false;
+        }
+        lua_rawset(state, -3);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// load_level_def(filename) -> table or nil
+int LoadLevelDef(lua_State* state) {
+  const char* filename = luaL_checkstring(state, 1);
+
+  FILE* file = fopen(filename, "rb");
+  if (!file) {
+    lua_pushnil(state);
+    return 1;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  std::vector<char> data(size);
+  if (fread(&data[0], 1, size, file) != (size_t)size) {
+    fclose(file);
+    lua_pushnil(state);
+    return 1;
+  }
+  fclose(file);
+
+  if (size < 12 || memcmp(&data[0], kLevelMagic, 4)) {
+    lua_pushnil(state);
+    return 1;
+  }
+  unsigned int version;
+  memcpy(&version, &data[4], 4);
+  if (version != kLevelVersion) {
+    fprintf(stderr, "unsupported level def version %u: %s\n", version,
+            filename);
+    lua_pushnil(state);
+    return 1;
+  }
+
+  const char* pos = &data[0] + 12;
+  const char* end = &data[0] + size;
+  if (!DecodeValue(state, &pos, end)) {
+    fprintf(stderr, "malformed level def: %s\n", filename);
+    lua_pushnil(state);
+  }
+  return 1;
+}
+
+}  // namespace
+
+int luaopen_level_def(lua_State* state) {
+  lua_register(state, "load_level_def", LoadLevelDef);
+  return 0;
+}
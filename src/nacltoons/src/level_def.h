@@ -0,0 +1,24 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef LEVEL_DEF_H_
+#define LEVEL_DEF_H_
+
+extern "C" {
+#include "lua.h"
+}
+
+/**
+ * Native loader for the compiled binary level format produced by
+ * build/compile_level.py.  Registers a global lua function
+ *
+ *   load_level_def(filename) -> table or nil
+ *
+ * which decodes the file straight into a lua table, skipping the
+ * YAML parse that dominates level-load time.  Returns nil for
+ * missing files or version mismatches so callers can fall back to
+ * the YAML source (see util.LoadLevelDef).
+ */
+int luaopen_level_def(lua_State* state);
+
+#endif  // LEVEL_DEF_H_
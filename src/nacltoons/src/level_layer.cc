@@ -4,9 +4,13 @@
 
 #include <stdint.h>
 
+#include <set>
+
 #include "level_layer.h"
 #include "app_delegate.h"
+#include "frame_profiler.h"
 #include "game_manager.h"
+#include "lua_lazy_bindings.h"
 
 #include "physics_nodes/CCPhysicsSprite.h"
 #include "CCLuaEngine.h"
@@ -23,25 +27,26 @@ extern "C" {
 // to Box2D "meters".
 #define PTM_RATIO 32
 
+// Cell size (in box2d meters) of the spatial hash used for batched
+// point queries.  With PTM_RATIO 32 this is 64 pixels per cell.
+#define SPATIAL_HASH_CELL_SIZE 2.0f
+
 USING_NS_CC_EXT;
 
 class Box2DCallbackHandler : public b2QueryCallback
 {
  public:
-  Box2DCallbackHandler(b2Vec2* test_point, CCLuaStack* lua_stack,
-                       int lua_handler) :
+  Box2DCallbackHandler(b2Vec2* test_point, std::vector<b2Body*>* hits) :
      test_point_(*test_point),
-     lua_handler_(lua_handler),
-     lua_stack_(lua_stack) {}
+     hits_(hits) {}
 
-  // Called by box2d when doing AABB testing to find bodies.
+  // Called by box2d when doing AABB testing to find bodies.  Only
+  // collects the hits; the caller dispatches them to lua once the
+  // world lock has been released.
   bool ReportFixture(b2Fixture* fixture)
   {
-    if (fixture->TestPoint(test_point_)) {
-      b2Body* body = fixture->GetBody();
-      lua_stack_->pushUserType(body, "b2Body");
-      lua_stack_->executeFunctionByHandler(lua_handler_, 1);
-    }
+    if (fixture->TestPoint(test_point_))
+      hits_->push_back(fixture->GetBody());
 
     return true; // keep looking
   }
@@ -49,8 +54,7 @@ class Box2DCallbackHandler : public b2QueryCallback
  protected:
   // Used by b2QueryCallback to find bodies as a given location
   b2Vec2 test_point_;
-  int lua_handler_;
-  CCLuaStack* lua_stack_;
+  std::vector<b2Body*>* hits_;
 };
 
 bool LevelLayer::init() {
@@ -63,16 +67,142 @@ bool LevelLayer::init() {
 
 bool LevelLayer::LoadLevel(int level_number) {
   // Load level from lua file.
-  LoadLua(level_number);
+  LoadLua(level_number, false);
   CCLog("loaded level");
   setTouchEnabled(true);
+  // Deliver buffered contact events once per frame.  The flush is
+  // scheduled (rather than run from the contact callbacks) so lua
+  // sees each frame's contacts in a single batched call.
+  schedule(schedule_selector(LevelLayer::FlushContactEvents));
+  // Snapshot body states so Restart can rewind in place.
+  RecordInitialState();
   return true;
 }
 
-LevelLayer::LevelLayer() : debug_enabled_(false) {
+bool LevelLayer::PrefetchLoad(int level_number) {
+  if (!LoadLua(level_number, true))
+    return false;
+  CCLog("prefetched level %d", level_number);
+  // Touch registration and the contact flush only take effect once
+  // the layer enters the running scene.
+  setTouchEnabled(true);
+  schedule(schedule_selector(LevelLayer::FlushContactEvents));
+  RecordInitialState();
+  return true;
+}
+
+void LevelLayer::ActivatePrefetched() {
+  // Installs the level state stashed by the lua PrefetchLevel and
+  // runs the deferred music/StartLevel hooks.
+  lua_stack_->executeFunctionByName("ActivatePrefetchedLevel", 0);
+}
+
+void LevelLayer::RecordInitialState() {
+  initial_state_.clear();
+  for (b2Body* body = box2d_world_->GetBodyList(); body;
+       body = body->GetNext()) {
+    BodyState state;
+    state.body = body;
+    state.position = body->GetPosition();
+    state.angle = body->GetAngle();
+    state.linear_velocity = body->GetLinearVelocity();
+    state.angular_velocity = body->GetAngularVelocity();
+    initial_state_.push_back(state);
+  }
+}
+
+CCNode* LevelLayer::FindNodeByTag(CCNode* root, int tag) {
+  if (root->getTag() == tag)
+    return root;
+  CCArray* children = root->getChildren();
+  if (!children)
+    return NULL;
+  for (uint32_t i = 0; i < children->count(); i++) {
+    CCNode* child = static_cast<CCNode*>(children->objectAtIndex(i));
+    CCNode* found = FindNodeByTag(child, tag);
+    if (found)
+      return found;
+  }
+  return NULL;
+}
+
+bool LevelLayer::ResetLevel() {
+  if (initial_state_.empty())
+    return false;
+
+  // The game's lua code owns level state (timers, scores, object
+  // maps) so it gets the first say: OnLevelReset returns 1 if the
+  // game reset its state and wants the fast in-place rewind, 0 to
+  // request a full rebuild.
+  lua_State* state = lua_stack_->getLuaState();
+  lua_getglobal(state, "OnLevelReset");
+  bool is_func = lua_isfunction(state, -1);
+  lua_pop(state, 1);
+  if (!is_func)
+    return false;
+  if (lua_stack_->executeFunctionByName("OnLevelReset", 0) != 1)
+    return false;
+
+  physics_thread_.LockWorld();
+
+  // Destroy bodies created after load (drawn shapes) along with
+  // their sprites.  Membership in the recorded list identifies the
+  // original level bodies.
+  std::set<b2Body*> recorded;
+  for (size_t i = 0; i < initial_state_.size(); i++)
+    recorded.insert(initial_state_[i].body);
+  b2Body* body = box2d_world_->GetBodyList();
+  while (body) {
+    b2Body* next = body->GetNext();
+    if (recorded.count(body) == 0) {
+      int tag = (intptr_t)body->GetUserData();
+      if (tag) {
+        CCNode* node = FindNodeByTag(this, tag);
+        if (node)
+          node->removeFromParentAndCleanup(true);
+      }
+      box2d_world_->DestroyBody(body);
+    }
+    body = next;
+  }
+
+  // Rewind the original bodies to their load-time state.
+  for (size_t i = 0; i < initial_state_.size(); i++) {
+    const BodyState& body_state = initial_state_[i];
+    body_state.body->SetTransform(body_state.position, body_state.angle);
+    body_state.body->SetLinearVelocity(body_state.linear_velocity);
+    body_state.body->SetAngularVelocity(body_state.angular_velocity);
+    body_state.body->SetAwake(true);
+  }
+
+  contact_events_.clear();
+  spatial_hash_dirty_ = true;
+  physics_thread_.UnlockWorld();
+  return true;
+}
+
+LevelLayer::LevelLayer()
+    : debug_enabled_(false),
+      spatial_hash_(SPATIAL_HASH_CELL_SIZE),
+      spatial_hash_dirty_(true),
+      contact_events_ref_(LUA_NOREF),
+      contact_began_ref_(LUA_NOREF),
+      contact_ended_ref_(LUA_NOREF),
+      contact_table_ref_(LUA_NOREF),
+      touch_flush_ref_(LUA_NOREF),
+      lua_stack_(NULL) {
 }
 
 LevelLayer::~LevelLayer() {
+  physics_thread_.Stop();
+  if (lua_stack_) {
+    lua_State* state = lua_stack_->getLuaState();
+    luaL_unref(state, LUA_REGISTRYINDEX, contact_events_ref_);
+    luaL_unref(state, LUA_REGISTRYINDEX, contact_began_ref_);
+    luaL_unref(state, LUA_REGISTRYINDEX, contact_ended_ref_);
+    luaL_unref(state, LUA_REGISTRYINDEX, contact_table_ref_);
+    luaL_unref(state, LUA_REGISTRYINDEX, touch_flush_ref_);
+  }
   delete box2d_world_;
 #ifdef COCOS2D_DEBUG
 #ifndef WIN32
@@ -81,21 +211,31 @@ LevelLayer::~LevelLayer() {
 #endif
 }
 
-bool LevelLayer::LoadLua(int level_number) {
+bool LevelLayer::LoadLua(int level_number, bool prefetch) {
   CCScriptEngineManager* manager = CCScriptEngineManager::sharedManager();
   CCLuaEngine* engine = (CCLuaEngine*)manager->getScriptEngine();
   assert(engine);
   lua_stack_ = engine->getLuaStack();
   assert(lua_stack_);
 
+  // The LevelLayer usertype is pushed from C++ before lua has read
+  // any of the module's globals, so force the lazily registered
+  // bindings open first.
+  LuaLazyEnsure(lua_stack_->getLuaState(), "level_layer");
+
   lua_stack_->pushCCObject(this, "LevelLayer");
   lua_stack_->pushInt(level_number);
-  int rtn = lua_stack_->executeFunctionByName("LoadLevel", 2);
+  const char* entry_point = prefetch ? "PrefetchLevel" : "LoadLevel";
+  int rtn = lua_stack_->executeFunctionByName(entry_point, 2);
   if (rtn == -1) {
     assert(false && "level loading failed");
     return false;
   }
 
+  // Cache references to the contact handlers now that the level
+  // script has had a chance to define them.
+  ResolveContactHandlers();
+
   return true;
 }
 
@@ -105,10 +245,11 @@ bool LevelLayer::InitPhysics() {
   box2d_world_->SetAllowSleeping(true);
   box2d_world_->SetContinuousPhysics(true);
   box2d_world_->SetContactListener(this);
+  box2d_world_->SetDestructionListener(this);
 
 #ifdef COCOS2D_DEBUG
 #ifndef WIN32
-  box2d_debug_draw_ = new GLESDebugDraw(PTM_RATIO);
+  box2d_debug_draw_ = new BatchedDebugDraw(PTM_RATIO);
   box2d_world_->SetDebugDraw(box2d_debug_draw_);
 
   uint32 flags = 0;
@@ -123,6 +264,68 @@ bool LevelLayer::InitPhysics() {
   return true;
 }
 
+void LevelLayer::SetPhysicsThreadEnabled(bool enabled) {
+  if (enabled == physics_thread_.IsRunning())
+    return;
+  if (enabled) {
+    physics_thread_.Start(box2d_world_, 1.0f / 60);
+    // Schedule update() so transform snapshots get applied every
+    // frame.
+    scheduleUpdate();
+  } else {
+    physics_thread_.Stop();
+    unscheduleUpdate();
+  }
+}
+
+void LevelLayer::SetParallelPhysicsEnabled(bool enabled) {
+  physics_thread_.SetParallelEnabled(enabled);
+}
+
+bool LevelLayer::ParallelPhysicsEnabled() {
+  return physics_thread_.ParallelEnabled();
+}
+
+void LevelLayer::LockWorld() {
+  physics_thread_.LockWorld();
+}
+
+void LevelLayer::UnlockWorld() {
+  physics_thread_.UnlockWorld();
+}
+
+void LevelLayer::update(float dt) {
+  if (!physics_thread_.IsRunning())
+    return;
+
+  ScopedTimer timer(PROFILE_SNAPSHOT_APPLY);
+
+  // Consume the most recent transform snapshot and apply it to the
+  // child nodes registered for each body.  Bodies are matched to
+  // nodes through the shared tag (see InitPhysicsNode in
+  // data/res/drawing.lua).  The world lock is held across both the
+  // fetch and the apply: CCPhysicsSprite forwards setPosition to
+  // b2Body::SetTransform, and the snapshot swap in the physics thread
+  // also happens under the lock, so the applied transforms always
+  // match the world's current step and never rewind bodies to an
+  // older one.
+  physics_thread_.LockWorld();
+  physics_thread_.GetSnapshot(&snapshot_);
+  for (size_t i = 0; i < snapshot_.size(); i++) {
+    const BodySnapshot& body_snapshot = snapshot_[i];
+    int tag = (intptr_t)body_snapshot.body->GetUserData();
+    if (!tag)
+      continue;
+    CCNode* node = getChildByTag(tag);
+    if (!node)
+      continue;
+    node->setPosition(ccp(body_snapshot.position.x * PTM_RATIO,
+                          body_snapshot.position.y * PTM_RATIO));
+    node->setRotation(-1 * CC_RADIANS_TO_DEGREES(body_snapshot.angle));
+  }
+  physics_thread_.UnlockWorld();
+}
+
 void LevelLayer::ToggleDebug() {
   debug_enabled_ = !debug_enabled_;
 
@@ -144,17 +347,68 @@ CCRect CalcBoundingBox(CCSprite* sprite) {
                     size.width, size.height/2);
 }
 
-void LevelLayer::LuaNotifyContact(b2Contact* contact,
-                                    const char* function_name) {
-  // Return early if lua didn't define the function_name
+// Call the function at the top of the stack (with |nargs| arguments
+// pushed above it) through lua_pcall, so a script error is logged and
+// swallowed instead of panicking and aborting the process -- the
+// protected-call behaviour CCLuaStack gives every other script entry
+// point.
+static void ProtectedCall(lua_State* state, int nargs) {
+  if (lua_pcall(state, nargs, 0, 0)) {
+    CCLog("LUA ERROR: %s", lua_tostring(state, -1));
+    lua_pop(state, 1);
+  }
+}
+
+// Take a reference to the global lua function with the given name,
+// or LUA_NOREF if it is not defined.
+static int RefGlobalFunction(lua_State* state, const char* name) {
+  lua_getglobal(state, name);
+  if (!lua_isfunction(state, -1)) {
+    lua_pop(state, 1);
+    return LUA_NOREF;
+  }
+  return luaL_ref(state, LUA_REGISTRYINDEX);
+}
+
+void LevelLayer::ResolveContactHandlers() {
   lua_State* state = lua_stack_->getLuaState();
-  lua_getglobal(state, function_name);
-  bool is_func = lua_isfunction(state, -1);
-  lua_pop(state, 1);
+  luaL_unref(state, LUA_REGISTRYINDEX, contact_events_ref_);
+  luaL_unref(state, LUA_REGISTRYINDEX, contact_began_ref_);
+  luaL_unref(state, LUA_REGISTRYINDEX, contact_ended_ref_);
+  luaL_unref(state, LUA_REGISTRYINDEX, contact_table_ref_);
+  luaL_unref(state, LUA_REGISTRYINDEX, touch_flush_ref_);
+
+  touch_flush_ref_ = RefGlobalFunction(state, "FlushTouchEvents");
+
+  // OnContactEvents receives the whole batch in one call.  The
+  // per-event handlers are kept as a fallback for games that define
+  // only OnContactBegan/OnContactEnded.
+  contact_events_ref_ = RefGlobalFunction(state, "OnContactEvents");
+  contact_began_ref_ = RefGlobalFunction(state, "OnContactBegan");
+  contact_ended_ref_ = RefGlobalFunction(state, "OnContactEnded");
+
+  // Preallocate the event table reused by every batched flush.
+  lua_createtable(state, 0, 0);
+  contact_table_ref_ = luaL_ref(state, LUA_REGISTRYINDEX);
+}
 
-  if (!is_func)
+unsigned int LevelLayer::InterestMask(int tag) const {
+  // Tags that never registered a mask are all-interesting so games
+  // that don't use interest filtering keep their current behaviour.
+  if ((size_t)tag >= interest_by_tag_.size())
+    return 0xFFFFFFFF;
+  return interest_by_tag_[tag];
+}
+
+void LevelLayer::SetBodyInterest(int tag, unsigned int mask) {
+  if (tag <= 0)
     return;
+  if ((size_t)tag >= interest_by_tag_.size())
+    interest_by_tag_.resize(tag + 1, 0xFFFFFFFF);
+  interest_by_tag_[tag] = mask;
+}
 
+void LevelLayer::QueueContactEvent(b2Contact* contact, bool began) {
   // Only send to lua collitions between body's that
   // have been tagged.
   b2Body* body1 = contact->GetFixtureA()->GetBody();
@@ -164,19 +418,103 @@ void LevelLayer::LuaNotifyContact(b2Contact* contact,
   if (!tag1 || !tag2)
     return;
 
-  // Call the lua function callback passing in tags of the two bodies that
-  // collided
-  lua_stack_->pushInt(tag1);
-  lua_stack_->pushInt(tag2);
-  lua_stack_->executeFunctionByName(function_name, 2);
+  // Drop pairs whose interest masks don't intersect before anything
+  // is queued, so e.g. constant ground contacts cost one AND here
+  // rather than a lua dispatch later.
+  if (!(InterestMask(tag1) & InterestMask(tag2)))
+    return;
+
+  ContactEvent event;
+  event.tag1 = tag1;
+  event.tag2 = tag2;
+  event.began = began;
+  contact_events_.push_back(event);
 }
 
 void LevelLayer::BeginContact(b2Contact* contact) {
-  LuaNotifyContact(contact, "OnContactBegan");
+  QueueContactEvent(contact, true);
 }
 
 void LevelLayer::EndContact(b2Contact* contact) {
-  LuaNotifyContact(contact, "OnContactEnded");
+  QueueContactEvent(contact, false);
+}
+
+void LevelLayer::SayGoodbye(b2Fixture* fixture) {
+  // A body is going away (DestroyBody destroys its fixtures through
+  // this callback), so any spatial hash built this frame holds
+  // pointers that are about to dangle.  Force a rebuild before the
+  // next batched query -- e.g. a double-click handler that removes a
+  // shape mid-frame, followed by another query in the same frame.
+  spatial_hash_dirty_ = true;
+}
+
+void LevelLayer::SayGoodbye(b2Joint* joint) {
+}
+
+void LevelLayer::FlushContactEvents(float dt) {
+  // The world advances once per frame, so any spatial hash built for
+  // a previous frame is now stale.
+  spatial_hash_dirty_ = true;
+
+  // This selector runs once per frame, which makes it a convenient
+  // place to emit the periodic instrumentation summary.
+  FrameProfiler::sharedProfiler()->ReportIfDue();
+
+  // Deliver the touch moves coalesced since the last frame before
+  // the contact batch, so handlers observe input and contacts in a
+  // consistent order.
+  if (touch_flush_ref_ != LUA_NOREF) {
+    lua_State* flush_state = lua_stack_->getLuaState();
+    lua_rawgeti(flush_state, LUA_REGISTRYINDEX, touch_flush_ref_);
+    ProtectedCall(flush_state, 0);
+  }
+
+  if (contact_events_.empty())
+    return;
+
+  ScopedTimer timer(PROFILE_CONTACT_DISPATCH);
+
+  // Swap the buffered events into the scratch list so the contact
+  // callbacks can keep appending (e.g. if a lua handler steps the
+  // world).  The world lock guards against the physics thread
+  // appending mid-swap.
+  physics_thread_.LockWorld();
+  contact_scratch_.clear();
+  contact_scratch_.swap(contact_events_);
+  physics_thread_.UnlockWorld();
+
+  lua_State* state = lua_stack_->getLuaState();
+  if (contact_events_ref_ != LUA_NOREF) {
+    // Batched delivery: fill the preallocated table with a flat
+    // (tag1, tag2, began) record per event and make a single call:
+    //   OnContactEvents(events, count)
+    lua_rawgeti(state, LUA_REGISTRYINDEX, contact_events_ref_);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, contact_table_ref_);
+    for (size_t i = 0; i < contact_scratch_.size(); i++) {
+      const ContactEvent& event = contact_scratch_[i];
+      lua_pushinteger(state, event.tag1);
+      lua_rawseti(state, -2, i * 3 + 1);
+      lua_pushinteger(state, event.tag2);
+      lua_rawseti(state, -2, i * 3 + 2);
+      lua_pushboolean(state, event.began);
+      lua_rawseti(state, -2, i * 3 + 3);
+    }
+    lua_pushinteger(state, contact_scratch_.size());
+    ProtectedCall(state, 2);
+    return;
+  }
+
+  // Fallback: one call per event through the cached function refs.
+  for (size_t i = 0; i < contact_scratch_.size(); i++) {
+    const ContactEvent& event = contact_scratch_[i];
+    int handler_ref = event.began ? contact_began_ref_ : contact_ended_ref_;
+    if (handler_ref == LUA_NOREF)
+      continue;
+    lua_rawgeti(state, LUA_REGISTRYINDEX, handler_ref);
+    lua_pushinteger(state, event.tag1);
+    lua_pushinteger(state, event.tag2);
+    ProtectedCall(state, 2);
+  }
 }
 
 void LevelLayer::LevelComplete() {
@@ -184,14 +522,33 @@ void LevelLayer::LevelComplete() {
   GameManager::sharedManager()->GameOver(true);
 }
 
+void LevelLayer::visit() {
+  // CCPhysicsSprite and CCPhysicsNode read their body's transform
+  // while the children are drawn, and debug draw (in draw() below)
+  // traverses the world's body and fixture lists, so the whole visit
+  // must be excluded from the physics thread's stepping.  Holding the
+  // lock for the visit is cheap relative to a frame; the snapshot
+  // path in update() still avoids any per-sprite locking.
+  bool lock_world = physics_thread_.IsRunning();
+  if (lock_world)
+    physics_thread_.LockWorld();
+  CCLayerColor::visit();
+  if (lock_world)
+    physics_thread_.UnlockWorld();
+}
+
 void LevelLayer::draw() {
+  ScopedTimer timer(PROFILE_DRAW);
   CCLayerColor::draw();
 
 #ifdef COCOS2D_DEBUG
   if (debug_enabled_) {
-    ccGLEnableVertexAttribs(kCCVertexAttribFlag_Position);
     kmGLPushMatrix();
+    // DrawDebugData only accumulates vertices; Flush issues the
+    // batched GL calls.  The world lock is held by visit() whenever
+    // the physics thread is running.
     box2d_world_->DrawDebugData();
+    box2d_debug_draw_->Flush();
     kmGLPopMatrix();
   }
 #endif
@@ -204,7 +561,70 @@ void LevelLayer::FindBodiesAt(b2Vec2* pos, int lua_handler) {
   aabb.lowerBound = *pos - d;
   aabb.upperBound = *pos + d;
 
-  // Query the world for overlapping shapes.
-  Box2DCallbackHandler handler(pos, lua_stack_, lua_handler);
+  // Query the world for overlapping shapes.  QueryAABB walks the
+  // broadphase tree that the physics thread rebalances during Step
+  // and TestPoint reads live body transforms, so the query runs under
+  // the world lock.  Hits are dispatched to lua only after unlocking:
+  // a handler that takes the lock itself (body creation/destruction)
+  // would otherwise deadlock.
+  std::vector<b2Body*> hits;
+  Box2DCallbackHandler handler(pos, &hits);
+  physics_thread_.LockWorld();
   box2d_world_->QueryAABB(&handler, aabb);
+  physics_thread_.UnlockWorld();
+
+  for (size_t i = 0; i < hits.size(); i++) {
+    lua_stack_->pushUserType(hits[i], "b2Body");
+    lua_stack_->executeFunctionByHandler(lua_handler, 1);
+  }
+}
+
+void LevelLayer::FindBodiesAtPoints(int points_table, int count,
+                                    int lua_handler) {
+  lua_State* state = lua_stack_->getLuaState();
+
+  // Pull the query points out of the flat lua table before anything
+  // else touches the stack.
+  std::vector<b2Vec2> points(count);
+  for (int i = 0; i < count; i++) {
+    lua_rawgeti(state, points_table, i * 2 + 1);
+    lua_rawgeti(state, points_table, i * 2 + 2);
+    points[i].Set(lua_tonumber(state, -2), lua_tonumber(state, -1));
+    lua_pop(state, 2);
+  }
+
+  // Collect (query_index, tag) pairs for every hit.  Untagged bodies
+  // are dropped here so lua never sees them.  The whole loop stays
+  // under the world lock -- QueryPoint's per-fixture TestPoint reads
+  // live body transforms while the physics thread steps -- and only
+  // the tags escape it, so the lua dispatch below runs unlocked.
+  std::vector<b2Body*> hits;
+  std::vector<int> results;
+  physics_thread_.LockWorld();
+  if (spatial_hash_dirty_) {
+    spatial_hash_.Rebuild(box2d_world_);
+    spatial_hash_dirty_ = false;
+  }
+  for (int i = 0; i < count; i++) {
+    hits.clear();
+    spatial_hash_.QueryPoint(points[i], &hits);
+    for (size_t j = 0; j < hits.size(); j++) {
+      int tag = (intptr_t)hits[j]->GetUserData();
+      if (!tag)
+        continue;
+      results.push_back(i + 1);  // 1-based to match lua conventions
+      results.push_back(tag);
+    }
+  }
+  physics_thread_.UnlockWorld();
+
+  // Deliver all hits to lua in a single call:
+  //   handler(results, pair_count)
+  lua_createtable(state, results.size(), 0);
+  for (size_t i = 0; i < results.size(); i++) {
+    lua_pushinteger(state, results[i]);
+    lua_rawseti(state, -2, i + 1);
+  }
+  lua_stack_->pushInt(results.size() / 2);
+  lua_stack_->executeFunctionByHandler(lua_handler, 2);
 }
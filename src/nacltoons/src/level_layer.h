@@ -7,10 +7,12 @@
 #include "cocos2d.h"
 #include "CCLuaStack.h"
 #include "Box2D/Box2D.h"
+#include "physics_thread.h"
+#include "spatial_hash.h"
 
 #ifdef COCOS2D_DEBUG
 #ifndef WIN32
-#include "GLES-Render.h"
+#include "batched_debug_draw.h"
 #endif
 #endif
 
@@ -18,12 +20,40 @@ USING_NS_CC;
 
 typedef std::vector<cocos2d::CCPoint> PointList;
 
+/**
+ * A single begin/end contact event between two tagged bodies,
+ * buffered during the world step and delivered to lua in a batch
+ * once per frame.
+ */
+struct ContactEvent {
+  int tag1;
+  int tag2;
+  bool began;
+};
+
+typedef std::vector<ContactEvent> ContactEventList;
+
+/**
+ * Initial state of a body recorded at level-load time so Restart can
+ * rewind the level in place instead of tearing it down.
+ */
+struct BodyState {
+  b2Body* body;
+  b2Vec2 position;
+  float32 angle;
+  b2Vec2 linear_velocity;
+  float32 angular_velocity;
+};
+
+typedef std::vector<BodyState> BodyStateList;
+
 /**
  * Lavel layer in which gameplay takes place.  This layer contains
  * the box2d world simulation.
  */
 class LevelLayer : public CCLayerColor,
-                   public b2ContactListener {
+                   public b2ContactListener,
+                   public b2DestructionListener {
  public:
   LevelLayer();
   ~LevelLayer();
@@ -31,50 +61,186 @@ class LevelLayer : public CCLayerColor,
   CREATE_FUNC(LevelLayer);
 
   virtual bool init();
+  // Holds the world lock across the subtree draw while the physics
+  // thread is running: CCPhysicsSprite/CCPhysicsNode read body
+  // transforms during the visit, and debug draw traverses the world.
+  virtual void visit();
   virtual void draw();
+  virtual void update(float dt);
 
   b2World* GetWorld() { return box2d_world_; }
 
+  // Enable or disable stepping of the world on a dedicated physics
+  // thread.  When enabled the world is stepped at a fixed timestep
+  // off the main thread and body transforms are applied to the
+  // matching (tagged) child nodes from a double-buffered snapshot
+  // each frame; the lua Update handler should not call world:Step
+  // in this mode.
+  void SetPhysicsThreadEnabled(bool enabled);
+  bool PhysicsThreadEnabled() { return physics_thread_.IsRunning(); }
+
+  // Opt-in parallel physics mode, for A/B testing against the serial
+  // path.  The Box2D solve itself stays single-threaded (the library
+  // is prebuilt), but the per-step transform readback is fanned out
+  // across a small worker pool; snapshot ordering and contact-event
+  // ordering are identical to the serial path (see
+  // PhysicsThread::SetParallelEnabled).  Only has an effect while the
+  // physics thread is enabled.
+  void SetParallelPhysicsEnabled(bool enabled);
+  bool ParallelPhysicsEnabled();
+
+  // Acquire/release the world lock.  Scripts that create or destroy
+  // bodies while the physics thread is enabled must hold this lock.
+  void LockWorld();
+  void UnlockWorld();
+
   // Find all bodies at a given position and call the
   // given lua_handler for each one.
   void FindBodiesAt(b2Vec2* pos, int lua_handler);
 
+  // Batched variant of FindBodiesAt.  |points_table| is the stack
+  // index of a flat lua table of world coordinates (x1, y1, x2, y2,
+  // ...) holding |count| query points.  Tests every point against
+  // the persistent spatial hash and calls lua_handler exactly once
+  // with a flat table of (query_index, tag) pairs plus the pair
+  // count.  The hash is rebuilt at most once per frame no matter how
+  // many points are queried.
+  void FindBodiesAtPoints(int points_table, int count, int lua_handler);
+
+  // Set the collision-interest bitmask for the body with the given
+  // tag.  Contacts are only queued for lua when the two bodies'
+  // masks intersect, so large static geometry (e.g. the ground) can
+  // be masked to zero and its constant contacts never touch the
+  // handler path.  Bodies that never set a mask default to
+  // all-interesting, preserving existing behaviour.
+  void SetBodyInterest(int tag, unsigned int mask);
+
   void ToggleDebug();
   bool LoadLevel(int level_number);
 
+  // Build the level without making it the running level: scripts
+  // run and bodies/sprites are created, but the lua level state is
+  // stashed instead of installed and music/StartLevel are deferred.
+  // Used by GameManager::PrefetchLevel to warm the next level's
+  // scene while the current one is being played.
+  bool PrefetchLoad(int level_number);
+
+  // Make a prefetch-loaded level the running level: installs the
+  // stashed lua level state and runs the deferred start hooks.
+  void ActivatePrefetched();
+
+  // Rewind the level to the state recorded at load time, reusing all
+  // existing body and sprite allocations: bodies created since load
+  // (drawn shapes) are destroyed and the remaining bodies have their
+  // transforms and velocities restored.  The lua OnLevelReset hook
+  // is consulted first; returns false (and changes nothing) if the
+  // game does not support in-place reset, in which case the caller
+  // should fall back to a full rebuild.
+  bool ResetLevel();
+
   // Called by box2d when contacts start
   void BeginContact(b2Contact* contact);
 
   // Called by box2d when contacts finish
   void EndContact(b2Contact* contact);
 
+  // Called by box2d when a fixture is destroyed (every DestroyBody
+  // destroys the body's fixtures through here).  Invalidates the
+  // spatial hash so cached b2Body pointers never dangle when a
+  // handler destroys a body mid-frame.
+  void SayGoodbye(b2Fixture* fixture);
+  void SayGoodbye(b2Joint* joint);
+
+  // Deliver all contact events buffered since the last flush to lua
+  // in a single batched call.  Scheduled to run once per frame.
+  void FlushContactEvents(float dt);
+
   // Methods that are exposed to / called by lua the lua
   // script.
   void LevelComplete();
 
  protected:
-  // Called by BeginContact and EndContact to nofify Lua code when box2d
-  // contacts start and finish.
-  void LuaNotifyContact(b2Contact* contact, const char* function_name);
+  // Called by BeginContact and EndContact to record a contact event
+  // for the next flush.  Events between untagged bodies are dropped
+  // here so they never reach lua.
+  void QueueContactEvent(b2Contact* contact, bool began);
 
-  bool LoadLua(int level_number);
+  // Look up the lua contact handlers once and store registry
+  // references to them, so per-frame dispatch avoids global table
+  // lookups.  Called after the level script has been loaded.
+  void ResolveContactHandlers();
+
+  bool LoadLua(int level_number, bool prefetch);
 
   bool InitPhysics();
 
+  // Snapshot the transforms and velocities of every body so
+  // ResetLevel can rewind to them.  Called once when the level has
+  // finished loading.
+  void RecordInitialState();
+
+  // Depth-first search for the descendant node with the given tag.
+  CCNode* FindNodeByTag(CCNode* root, int tag);
+
  private:
   // Box2D physics world
   b2World* box2d_world_;
 
 #ifdef COCOS2D_DEBUG
 #ifndef WIN32
-  // Debug drawing support for Box2D.
-  GLESDebugDraw* box2d_debug_draw_;
+  // Debug drawing support for Box2D.  Accumulates all shapes and
+  // joints into per-frame vertex batches drawn in a couple of GL
+  // calls (see batched_debug_draw.h).
+  BatchedDebugDraw* box2d_debug_draw_;
 #endif
 #endif
 
   // Flag to enable drawing of Box2D debug data.
   bool debug_enabled_;
 
+  // Worker thread used to step the world when the physics thread
+  // mode is enabled.
+  PhysicsThread physics_thread_;
+
+  // Scratch buffer used when consuming transform snapshots, kept as
+  // a member to avoid a per-frame allocation.
+  SnapshotList snapshot_;
+
+  // Spatial index over the world's fixtures used by the batched
+  // point queries, rebuilt lazily once per frame.
+  SpatialHash spatial_hash_;
+  bool spatial_hash_dirty_;
+
+  // Returns the interest mask for a tag (all bits set when the tag
+  // never registered one).
+  unsigned int InterestMask(int tag) const;
+
+  // Per-body state recorded at load time, used by ResetLevel.
+  BodyStateList initial_state_;
+
+  // Collision-interest masks indexed by body tag; tags are small
+  // sequential integers assigned by the game scripts so a flat array
+  // keeps the per-contact test to two loads and an AND.
+  std::vector<unsigned int> interest_by_tag_;
+
+  // Contact events buffered during the world step, plus a scratch
+  // list that the buffer is swapped into during the flush so new
+  // events can accumulate while lua handlers run.
+  ContactEventList contact_events_;
+  ContactEventList contact_scratch_;
+
+  // Registry references to the lua contact handlers, resolved once
+  // at level load (LUA_NOREF when not defined).  contact_table_ref_
+  // holds the preallocated event table reused by every flush.
+  int contact_events_ref_;
+  int contact_began_ref_;
+  int contact_ended_ref_;
+  int contact_table_ref_;
+
+  // Registry reference to the global FlushTouchEvents function,
+  // called once per frame to deliver coalesced touch-move polylines.
+  int touch_flush_ref_;
+
   CCLuaStack* lua_stack_;
 };
 
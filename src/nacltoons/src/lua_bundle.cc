@@ -0,0 +1,126 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lua_bundle.h"
+
+#include <stdio.h>
+#include <string.h>
+
+extern "C" {
+#include "lauxlib.h"
+}
+
+namespace {
+
+const char kBundleMagic[] = "NTLB";
+const unsigned int kBundleVersion = 1;
+
+// Read a little-endian uint32 from the given position.
+unsigned int ReadU32(const char* data) {
+  unsigned int value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+LuaBundle* LuaBundle::sharedBundle() {
+  static LuaBundle* shared_bundle = NULL;
+  if (!shared_bundle)
+    shared_bundle = new LuaBundle();
+  return shared_bundle;
+}
+
+bool LuaBundle::Load(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return false;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  data_.resize(size);
+  if (fread(&data_[0], 1, size, file) != (size_t)size) {
+    fclose(file);
+    data_.clear();
+    return false;
+  }
+  fclose(file);
+
+  if (size < 12 || memcmp(&data_[0], kBundleMagic, 4) ||
+      ReadU32(&data_[4]) != kBundleVersion) {
+    data_.clear();
+    return false;
+  }
+
+  unsigned int count = ReadU32(&data_[8]);
+  size_t pos = 12;
+  for (unsigned int i = 0; i < count; i++) {
+    if (pos + 4 > data_.size())
+      return false;
+    unsigned int name_len = ReadU32(&data_[pos]);
+    pos += 4;
+    if (pos + name_len + 8 > data_.size())
+      return false;
+    std::string name(&data_[pos], name_len);
+    pos += name_len;
+    ChunkInfo info;
+    info.offset = ReadU32(&data_[pos]);
+    info.size = ReadU32(&data_[pos + 4]);
+    pos += 8;
+    if (info.offset + info.size > data_.size())
+      return false;
+    chunks_[name] = info;
+  }
+
+  loaded_ = true;
+  return true;
+}
+
+bool LuaBundle::LoadChunk(lua_State* state, const char* name) {
+  ChunkMap::iterator it = chunks_.find(name);
+  if (it == chunks_.end())
+    return false;
+  const ChunkInfo& info = it->second;
+  if (luaL_loadbuffer(state, &data_[info.offset], info.size, name)) {
+    fprintf(stderr, "error loading lua chunk '%s': %s\n", name,
+            lua_tostring(state, -1));
+    lua_pop(state, 1);
+    return false;
+  }
+  return true;
+}
+
+int LuaBundle::ExecuteChunk(lua_State* state, const char* name) {
+  if (!LoadChunk(state, name))
+    return -1;
+  int rtn = lua_pcall(state, 0, 0, 0);
+  if (rtn) {
+    fprintf(stderr, "error running lua chunk '%s': %s\n", name,
+            lua_tostring(state, -1));
+    lua_pop(state, 1);
+  }
+  return rtn;
+}
+
+int LuaBundle::RequireLoader(lua_State* state) {
+  LuaBundle* bundle = sharedBundle();
+  const char* name = lua_tostring(state, 1);
+  if (!bundle->LoadChunk(state, name))
+    lua_pushnil(state);
+  return 1;
+}
+
+void LuaBundle::InstallLoader(lua_State* state) {
+  // Insert our searcher at the front of package.loaders so bundled
+  // bytecode wins over .lua files on disk.
+  lua_getglobal(state, "package");
+  lua_getfield(state, -1, "loaders");
+  lua_getglobal(state, "table");
+  lua_getfield(state, -1, "insert");
+  lua_pushvalue(state, -3);  // package.loaders
+  lua_pushinteger(state, 1);
+  lua_pushcfunction(state, RequireLoader);
+  lua_call(state, 3, 0);
+  lua_pop(state, 3);  // table, loaders, package
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef LUA_BUNDLE_H_
+#define LUA_BUNDLE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "lua.h"
+}
+
+/**
+ * Reader for the precompiled lua bytecode bundle produced by
+ * build/pack_lua.py.  The whole bundle is read into memory once at
+ * startup and individual chunks are then served by offset, so no lua
+ * source text is parsed in release builds.  Debug builds skip the
+ * bundle entirely and load .lua sources as before.
+ */
+class LuaBundle {
+ public:
+  static LuaBundle* sharedBundle();
+
+  // Load and index the bundle at the given path.  Returns false if
+  // the file is missing or malformed (callers then fall back to
+  // loading lua source).
+  bool Load(const char* path);
+
+  bool loaded() { return loaded_; }
+
+  // Load the chunk with the given module name onto the lua stack as
+  // a function.  Returns false if the bundle does not contain it.
+  bool LoadChunk(lua_State* state, const char* name);
+
+  // Load and run the chunk with the given module name.  Returns the
+  // lua error code (0 on success).
+  int ExecuteChunk(lua_State* state, const char* name);
+
+  // Add a searcher to package.loaders that resolves require() from
+  // the bundle before the filesystem loaders run.
+  void InstallLoader(lua_State* state);
+
+ private:
+  LuaBundle() : loaded_(false) {}
+
+  struct ChunkInfo {
+    size_t offset;
+    size_t size;
+  };
+  typedef std::map<std::string, ChunkInfo> ChunkMap;
+
+  static int RequireLoader(lua_State* state);
+
+  bool loaded_;
+  std::vector<char> data_;
+  ChunkMap chunks_;
+};
+
+#endif  // LUA_BUNDLE_H_
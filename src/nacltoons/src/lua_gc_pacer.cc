@@ -0,0 +1,82 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lua_gc_pacer.h"
+
+#include "frame_profiler.h"
+
+extern "C" {
+#include "lauxlib.h"
+}
+
+namespace {
+
+// Work units handed to lua_gc per step; small enough that the budget
+// check between steps keeps pauses close to the budget.
+const int kGCStepSize = 2;
+
+}  // namespace
+
+LuaGCPacer* LuaGCPacer::sharedPacer() {
+  static LuaGCPacer* shared_pacer = NULL;
+  if (!shared_pacer)
+    shared_pacer = new LuaGCPacer();
+  return shared_pacer;
+}
+
+void LuaGCPacer::Attach(lua_State* state) {
+  state_ = state;
+  // Automatic collection stays off from here on; the collector only
+  // runs inside StepWithBudget.  This also means nothing can trigger
+  // a collection during the physics step or contact dispatch.
+  lua_gc(state, LUA_GCSTOP, 0);
+  lua_register(state, "set_gc_budget", SetBudget);
+
+  // Schedule the per-frame step on the director's scheduler rather
+  // than on any particular layer, so the collector keeps running
+  // while menu or loading scenes are up.  The pacer is a singleton,
+  // so schedule only once even if a reload attaches a new state.
+  if (!scheduled_) {
+    scheduled_ = true;
+    cocos2d::CCDirector::sharedDirector()->getScheduler()->scheduleSelector(
+        schedule_selector(LuaGCPacer::Step), this, 0, false);
+  }
+}
+
+void LuaGCPacer::Step(float dt) {
+  StepWithBudget();
+}
+
+void LuaGCPacer::set_budget_ms(float budget_ms) {
+  budget_ms_ = budget_ms;
+  if (!state_)
+    return;
+  if (budget_ms_ <= 0)
+    lua_gc(state_, LUA_GCRESTART, 0);
+  else
+    lua_gc(state_, LUA_GCSTOP, 0);
+}
+
+void LuaGCPacer::StepWithBudget() {
+  if (!state_ || budget_ms_ <= 0)
+    return;
+
+  ScopedTimer timer(PROFILE_LUA_GC);
+  double deadline = FrameProfiler::Now() + budget_ms_ / 1000.0;
+  do {
+    if (lua_gc(state_, LUA_GCSTEP, kGCStepSize)) {
+      // Full cycle completed; no point burning the rest of the
+      // budget starting the next one this frame.
+      break;
+    }
+  } while (FrameProfiler::Now() < deadline);
+  // Stepping re-arms the automatic collector in lua 5.1, so stop it
+  // again to keep all collection inside the budget.
+  lua_gc(state_, LUA_GCSTOP, 0);
+}
+
+int LuaGCPacer::SetBudget(lua_State* state) {
+  sharedPacer()->set_budget_ms(luaL_checknumber(state, 1));
+  return 0;
+}
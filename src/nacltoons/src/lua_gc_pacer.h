@@ -0,0 +1,58 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef LUA_GC_PACER_H_
+#define LUA_GC_PACER_H_
+
+#include "cocos2d.h"
+
+extern "C" {
+#include "lua.h"
+}
+
+/**
+ * Explicit pacing for the lua garbage collector.  The default
+ * incremental GC fires whenever an allocation crosses its threshold,
+ * which in practice means mid-frame -- right when contact handlers
+ * are allocating -- causing 10-20ms hitches.  The pacer stops
+ * automatic collection entirely and instead steps the collector with
+ * a fixed time budget once per frame, at the end of the frame's
+ * update pass.  Pause times are recorded under the lua_gc
+ * instrumentation category so GC behaviour shows up in the
+ * PostMessage profile summaries.
+ *
+ * Scripts can tune the budget with the global set_gc_budget(ms)
+ * (0 restores lua's automatic collection).
+ */
+class LuaGCPacer : public cocos2d::CCObject {
+ public:
+  static LuaGCPacer* sharedPacer();
+
+  // Take over collection on the given state: stops the automatic GC,
+  // registers the set_gc_budget lua function and schedules the
+  // per-frame step directly on the director's scheduler, so the
+  // collector keeps running on menu and loading scenes that have no
+  // level layer.
+  void Attach(lua_State* state);
+
+  // Run collector steps until the per-frame budget is used up (or a
+  // full cycle completes).  Cheap no-op when nothing is attached.
+  void StepWithBudget();
+
+  // Scheduler callback wrapping StepWithBudget.
+  void Step(float dt);
+
+  void set_budget_ms(float budget_ms);
+
+ private:
+  LuaGCPacer() : state_(0), budget_ms_(2.0f), scheduled_(false) {}
+
+  // lua: set_gc_budget(ms)
+  static int SetBudget(lua_State* state);
+
+  lua_State* state_;
+  float budget_ms_;
+  bool scheduled_;
+};
+
+#endif  // LUA_GC_PACER_H_
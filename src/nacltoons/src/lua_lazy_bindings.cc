@@ -0,0 +1,130 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "lua_lazy_bindings.h"
+
+extern "C" {
+#include "lauxlib.h"
+}
+
+namespace {
+
+// Registry keys for the two bookkeeping tables:
+//   triggers: global name -> module name
+//   openers:  module name -> open function (removed once run)
+const char kTriggersKey[] = "nacltoons.lazy.triggers";
+const char kOpenersKey[] = "nacltoons.lazy.openers";
+
+// Run and remove the opener for the module name at the top of the
+// stack (the name is consumed).  Does nothing if the module has
+// already been opened.
+void OpenModule(lua_State* state) {
+  lua_getfield(state, LUA_REGISTRYINDEX, kOpenersKey);
+  lua_insert(state, -2);                 // openers, module
+  lua_pushvalue(state, -1);              // openers, module, module
+  lua_rawget(state, -3);                 // openers, module, opener
+  if (lua_isfunction(state, -1)) {
+    // Clear the entry first so a re-entrant lookup from inside the
+    // opener cannot run it twice.
+    lua_pushvalue(state, -2);
+    lua_pushnil(state);
+    lua_rawset(state, -5);               // openers[module] = nil
+    lua_call(state, 0, 0);
+    lua_pop(state, 2);                   // openers, module
+  } else {
+    lua_pop(state, 3);
+  }
+}
+
+// __index metamethod installed on the globals table.  Fires only for
+// names that are not yet defined; if the name is one of a lazy
+// module's triggers the module is opened and the (now defined) global
+// returned.  Upvalue 1 holds any __index that was in place before, so
+// other users of the globals metatable keep working.
+int GlobalIndex(lua_State* state) {
+  if (lua_isstring(state, 2)) {
+    lua_getfield(state, LUA_REGISTRYINDEX, kTriggersKey);
+    lua_pushvalue(state, 2);
+    lua_rawget(state, -2);               // triggers[key] -> module name
+    if (lua_isstring(state, -1)) {
+      OpenModule(state);
+      lua_pushvalue(state, 2);
+      lua_rawget(state, 1);              // re-read the global
+      return 1;
+    }
+    lua_pop(state, 2);
+  }
+
+  // Fall through to the previous __index, if any.
+  if (lua_isfunction(state, lua_upvalueindex(1))) {
+    lua_pushvalue(state, lua_upvalueindex(1));
+    lua_pushvalue(state, 1);
+    lua_pushvalue(state, 2);
+    lua_call(state, 2, 1);
+    return 1;
+  }
+  if (lua_istable(state, lua_upvalueindex(1))) {
+    lua_pushvalue(state, 2);
+    lua_gettable(state, lua_upvalueindex(1));
+    return 1;
+  }
+  lua_pushnil(state);
+  return 1;
+}
+
+// Create the bookkeeping tables and hook the globals metatable.  Safe
+// to call more than once.
+void Install(lua_State* state) {
+  lua_getfield(state, LUA_REGISTRYINDEX, kTriggersKey);
+  bool installed = !lua_isnil(state, -1);
+  lua_pop(state, 1);
+  if (installed)
+    return;
+
+  lua_newtable(state);
+  lua_setfield(state, LUA_REGISTRYINDEX, kTriggersKey);
+  lua_newtable(state);
+  lua_setfield(state, LUA_REGISTRYINDEX, kOpenersKey);
+
+  lua_pushvalue(state, LUA_GLOBALSINDEX);
+  if (!lua_getmetatable(state, -1))
+    lua_newtable(state);
+  // Preserve any existing __index as an upvalue of ours.
+  lua_getfield(state, -1, "__index");
+  lua_pushcclosure(state, GlobalIndex, 1);
+  lua_setfield(state, -2, "__index");
+  lua_setmetatable(state, -2);
+  lua_pop(state, 1);
+}
+
+}  // namespace
+
+void LuaLazyRegister(lua_State* state,
+                     const char* module,
+                     lua_CFunction opener,
+                     const char* const triggers[]) {
+  Install(state);
+
+  lua_getfield(state, LUA_REGISTRYINDEX, kOpenersKey);
+  lua_pushcfunction(state, opener);
+  lua_setfield(state, -2, module);
+  lua_pop(state, 1);
+
+  lua_getfield(state, LUA_REGISTRYINDEX, kTriggersKey);
+  for (int i = 0; triggers[i]; i++) {
+    lua_pushstring(state, module);
+    lua_setfield(state, -2, triggers[i]);
+  }
+  lua_pop(state, 1);
+}
+
+void LuaLazyEnsure(lua_State* state, const char* module) {
+  lua_getfield(state, LUA_REGISTRYINDEX, kTriggersKey);
+  if (lua_isnil(state, -1)) {
+    lua_pop(state, 1);
+    return;
+  }
+  lua_pop(state, 1);
+  lua_pushstring(state, module);
+  OpenModule(state);
+}
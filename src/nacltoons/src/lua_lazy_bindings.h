@@ -0,0 +1,42 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef LUA_LAZY_BINDINGS_H_
+#define LUA_LAZY_BINDINGS_H_
+
+extern "C" {
+#include "lua.h"
+}
+
+/**
+ * Lazy registration of lua binding modules.
+ *
+ * The box2d bindings alone register hundreds of classes from the 32k
+ * line LuaBox2D.cpp, which is a measurable chunk of time-to-first-paint
+ * even though a freshly started game only touches a handful of globals
+ * before the first level loads.  Instead of running every tolua open
+ * function at startup, each module is registered here together with the
+ * list of globals it defines that our lua code actually refers to.  A
+ * metatable on the globals table materializes the whole module the
+ * first time one of those names is read, so startup pays only for the
+ * modules loader.lua really uses.
+ *
+ * C++ code that pushes a usertype belonging to a lazy module (e.g.
+ * LevelLayer::LoadLua pushing itself, or the GetWorld glue pushing a
+ * b2World) must call LuaLazyEnsure() first so the type's metatable
+ * exists.
+ */
+
+// Register 'opener' to run the first time any of the globals named in
+// the NULL-terminated 'triggers' array is read.  'module' is an
+// arbitrary name used to identify the module in LuaLazyEnsure().
+void LuaLazyRegister(lua_State* state,
+                     const char* module,
+                     lua_CFunction opener,
+                     const char* const triggers[]);
+
+// Run the named module's opener now if it has not run yet.  Safe to
+// call for modules that are already open.
+void LuaLazyEnsure(lua_State* state, const char* module);
+
+#endif  // LUA_LAZY_BINDINGS_H_
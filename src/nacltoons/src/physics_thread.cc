@@ -0,0 +1,286 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "physics_thread.h"
+#include "alloc_telemetry.h"
+#include "frame_profiler.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+// Iteration counts matching the values used by the lua game code
+// (see data/res/sample_game/game.lua).
+const int kVelocityIterations = 8;
+const int kPositionIterations = 1;
+
+// Bodies per work unit claimed by the snapshot workers.  Small enough
+// to balance the pool on mid-sized worlds, large enough that the
+// atomic claim is negligible.
+const int kSnapshotChunkSize = 64;
+
+// Sleep for the given number of seconds (sub-second resolution).
+void SleepSeconds(float seconds) {
+  if (seconds <= 0)
+    return;
+  struct timespec ts;
+  ts.tv_sec = (time_t)seconds;
+  ts.tv_nsec = (long)((seconds - (float)ts.tv_sec) * 1e9f);
+  while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+    continue;
+}
+
+// Monotonic clock reading in seconds.
+double NowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+}  // namespace
+
+const int PhysicsThread::kNumWorkers;
+
+PhysicsThread::PhysicsThread()
+    : world_(NULL),
+      timestep_(1.0f / 60),
+      running_(false),
+      front_buffer_(&buffers_[0]),
+      back_buffer_(&buffers_[1]),
+      velocity_iterations_(kVelocityIterations),
+      position_iterations_(kPositionIterations),
+      pool_running_(false),
+      step_generation_(0),
+      workers_done_(0),
+      next_chunk_(0) {
+  pthread_mutex_init(&world_mutex_, NULL);
+  pthread_mutex_init(&snapshot_mutex_, NULL);
+  pthread_mutex_init(&pool_mutex_, NULL);
+  pthread_cond_init(&pool_wake_, NULL);
+  pthread_cond_init(&pool_done_, NULL);
+}
+
+PhysicsThread::~PhysicsThread() {
+  Stop();
+  SetParallelEnabled(false);
+  pthread_cond_destroy(&pool_done_);
+  pthread_cond_destroy(&pool_wake_);
+  pthread_mutex_destroy(&pool_mutex_);
+  pthread_mutex_destroy(&snapshot_mutex_);
+  pthread_mutex_destroy(&world_mutex_);
+}
+
+bool PhysicsThread::Start(b2World* world, float timestep) {
+  assert(world);
+  if (running_)
+    return false;
+  world_ = world;
+  timestep_ = timestep;
+  running_ = true;
+  if (pthread_create(&thread_, NULL, ThreadMain, this)) {
+    running_ = false;
+    return false;
+  }
+  return true;
+}
+
+void PhysicsThread::Stop() {
+  if (!running_)
+    return;
+  running_ = false;
+  pthread_join(thread_, NULL);
+}
+
+void* PhysicsThread::ThreadMain(void* arg) {
+  static_cast<PhysicsThread*>(arg)->Run();
+  return NULL;
+}
+
+void PhysicsThread::Run() {
+  while (running_) {
+    double start = NowSeconds();
+    StepOnce();
+    // Sleep for the remainder of the fixed timestep so the simulation
+    // advances in real time rather than as fast as possible.
+    SleepSeconds(timestep_ - (float)(NowSeconds() - start));
+  }
+}
+
+void PhysicsThread::StepOnce() {
+  ScopedAllocTag alloc_tag(ALLOC_TAG_PHYSICS);
+  pthread_mutex_lock(&world_mutex_);
+  {
+    ScopedTimer timer(PROFILE_WORLD_STEP);
+    world_->Step(timestep_, velocity_iterations_, position_iterations_);
+  }
+
+  // Record the post-step transform of every non-static body into the
+  // back buffer.  Static bodies never move so there is no point
+  // shipping them to the render thread every step.
+  back_buffer_->clear();
+  if (pool_running_) {
+    RecordSnapshotParallel();
+  } else {
+    for (b2Body* body = world_->GetBodyList(); body;
+         body = body->GetNext()) {
+      if (body->GetType() == b2_staticBody)
+        continue;
+      BodySnapshot snapshot;
+      snapshot.body = body;
+      snapshot.position = body->GetPosition();
+      snapshot.angle = body->GetAngle();
+      back_buffer_->push_back(snapshot);
+    }
+  }
+
+  // Publish the new snapshot by swapping buffers.  This happens
+  // before the world lock is released so a reader that holds the
+  // world lock always sees a front buffer consistent with the world's
+  // current state -- there is no window where the world has advanced
+  // but the swap hasn't happened yet.
+  pthread_mutex_lock(&snapshot_mutex_);
+  SnapshotList* tmp = front_buffer_;
+  front_buffer_ = back_buffer_;
+  back_buffer_ = tmp;
+  pthread_mutex_unlock(&snapshot_mutex_);
+
+  pthread_mutex_unlock(&world_mutex_);
+}
+
+void PhysicsThread::RecordSnapshotParallel() {
+  // Collect the bodies first so every body has a fixed output slot;
+  // the workers then fill disjoint slices of the back buffer and the
+  // published snapshot comes out in the same order as the serial
+  // path.
+  body_scratch_.clear();
+  for (b2Body* body = world_->GetBodyList(); body;
+       body = body->GetNext()) {
+    if (body->GetType() == b2_staticBody)
+      continue;
+    body_scratch_.push_back(body);
+  }
+  back_buffer_->resize(body_scratch_.size());
+
+  pthread_mutex_lock(&pool_mutex_);
+  next_chunk_ = 0;
+  workers_done_ = 0;
+  step_generation_++;
+  pthread_cond_broadcast(&pool_wake_);
+  pthread_mutex_unlock(&pool_mutex_);
+
+  // Take part in the readback rather than just waiting for the
+  // workers.  The world lock is held throughout, so the workers only
+  // ever perform const reads on a quiescent world.
+  ProcessSnapshotChunks();
+
+  pthread_mutex_lock(&pool_mutex_);
+  while (workers_done_ < kNumWorkers)
+    pthread_cond_wait(&pool_done_, &pool_mutex_);
+  pthread_mutex_unlock(&pool_mutex_);
+}
+
+void PhysicsThread::ProcessSnapshotChunks() {
+  for (;;) {
+    int chunk = __sync_fetch_and_add(&next_chunk_, 1);
+    size_t begin = (size_t)chunk * kSnapshotChunkSize;
+    if (begin >= body_scratch_.size())
+      return;
+    size_t end = begin + kSnapshotChunkSize;
+    if (end > body_scratch_.size())
+      end = body_scratch_.size();
+    for (size_t i = begin; i < end; i++) {
+      b2Body* body = body_scratch_[i];
+      BodySnapshot* snapshot = &(*back_buffer_)[i];
+      snapshot->body = body;
+      snapshot->position = body->GetPosition();
+      snapshot->angle = body->GetAngle();
+    }
+  }
+}
+
+void* PhysicsThread::WorkerMain(void* arg) {
+  static_cast<PhysicsThread*>(arg)->WorkerRun();
+  return NULL;
+}
+
+void PhysicsThread::WorkerRun() {
+  // The generation counter is reset to zero before the workers are
+  // created (see SetParallelEnabled), so starting from zero here
+  // cannot miss a dispatch that lands before this thread first parks.
+  unsigned seen_generation = 0;
+  for (;;) {
+    pthread_mutex_lock(&pool_mutex_);
+    while (pool_running_ && step_generation_ == seen_generation)
+      pthread_cond_wait(&pool_wake_, &pool_mutex_);
+    if (!pool_running_) {
+      pthread_mutex_unlock(&pool_mutex_);
+      return;
+    }
+    seen_generation = step_generation_;
+    pthread_mutex_unlock(&pool_mutex_);
+
+    ProcessSnapshotChunks();
+
+    pthread_mutex_lock(&pool_mutex_);
+    workers_done_++;
+    if (workers_done_ == kNumWorkers)
+      pthread_cond_signal(&pool_done_);
+    pthread_mutex_unlock(&pool_mutex_);
+  }
+}
+
+void PhysicsThread::SetParallelEnabled(bool enabled) {
+  // Toggling is serialized against StepOnce via the world lock, so a
+  // dispatch is never in flight while workers are started or torn
+  // down.
+  pthread_mutex_lock(&world_mutex_);
+  if (enabled == pool_running_) {
+    pthread_mutex_unlock(&world_mutex_);
+    return;
+  }
+  if (enabled) {
+    pool_running_ = true;
+    // No dispatch can run while the world lock is held, so the
+    // generation counter can be rewound for the new workers.
+    step_generation_ = 0;
+    for (int i = 0; i < kNumWorkers; i++) {
+      if (pthread_create(&workers_[i], NULL, WorkerMain, this)) {
+        // Could not bring up the full pool: tear down whatever
+        // started and stay on the serial path.
+        pthread_mutex_lock(&pool_mutex_);
+        pool_running_ = false;
+        pthread_cond_broadcast(&pool_wake_);
+        pthread_mutex_unlock(&pool_mutex_);
+        while (i-- > 0)
+          pthread_join(workers_[i], NULL);
+        break;
+      }
+    }
+  } else {
+    pthread_mutex_lock(&pool_mutex_);
+    pool_running_ = false;
+    pthread_cond_broadcast(&pool_wake_);
+    pthread_mutex_unlock(&pool_mutex_);
+    for (int i = 0; i < kNumWorkers; i++)
+      pthread_join(workers_[i], NULL);
+  }
+  pthread_mutex_unlock(&world_mutex_);
+}
+
+void PhysicsThread::GetSnapshot(SnapshotList* out) {
+  pthread_mutex_lock(&snapshot_mutex_);
+  *out = *front_buffer_;
+  pthread_mutex_unlock(&snapshot_mutex_);
+}
+
+void PhysicsThread::LockWorld() {
+  pthread_mutex_lock(&world_mutex_);
+}
+
+void PhysicsThread::UnlockWorld() {
+  pthread_mutex_unlock(&world_mutex_);
+}
@@ -0,0 +1,145 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef PHYSICS_THREAD_H_
+#define PHYSICS_THREAD_H_
+
+#include <pthread.h>
+#include <vector>
+
+#include "Box2D/Box2D.h"
+
+/**
+ * Snapshot of a single body's transform, produced by the physics
+ * thread at the end of each step and consumed by the render thread.
+ */
+struct BodySnapshot {
+  b2Body* body;
+  b2Vec2 position;
+  float32 angle;
+};
+
+typedef std::vector<BodySnapshot> SnapshotList;
+
+/**
+ * Steps a b2World at a fixed timestep on a dedicated pthread so that
+ * simulation and rendering can overlap.  After every step the transforms
+ * of all non-static bodies are written into the back snapshot buffer,
+ * which is then swapped with the front buffer.  The render thread reads
+ * only the front buffer (via GetSnapshot) and never touches live body
+ * state while the world is being stepped.
+ *
+ * Any code that mutates the world directly (body creation from touch
+ * handlers, Lua callbacks, etc.) must hold the world lock via
+ * LockWorld/UnlockWorld while doing so.
+ */
+class PhysicsThread {
+ public:
+  PhysicsThread();
+  ~PhysicsThread();
+
+  // Start stepping the given world at the given fixed timestep
+  // (in seconds).  The world must outlive this object or Stop()
+  // must be called before the world is destroyed.
+  bool Start(b2World* world, float timestep);
+
+  // Stop the worker thread.  Blocks until the thread has joined.
+  // Safe to call when not started.
+  void Stop();
+
+  bool IsRunning() const { return running_; }
+
+  // Enable or disable the snapshot worker pool.  Box2D ships as a
+  // prebuilt naclports library, so the island solve inside
+  // b2World::Step cannot be distributed across threads from here; in
+  // parallel mode the pool instead fans out the post-step transform
+  // readback (the per-body loop in StepOnce) across a couple of
+  // workers while the stepping thread still holds the world lock.
+  // Bodies are indexed before the fan-out, so the published snapshot
+  // is identical to the serial one, and contact callbacks keep firing
+  // serially inside Step in solver order.  Off by default; safe to
+  // toggle while the thread is running.
+  void SetParallelEnabled(bool enabled);
+  bool ParallelEnabled() const { return pool_running_; }
+
+  // Copy the most recent transform snapshot into |out|.  Callers that
+  // go on to write the transforms back into live bodies (which
+  // CCPhysicsSprite::setPosition does) must hold the world lock
+  // across the fetch and the apply: the buffer swap in StepOnce
+  // happens under the world lock, so a holder always reads a snapshot
+  // that matches the world's current step and can never rewind bodies
+  // to an older one.
+  void GetSnapshot(SnapshotList* out);
+
+  // Acquire/release the lock that protects the world from concurrent
+  // stepping.  Hold this around any direct world mutation performed
+  // outside the physics thread.
+  void LockWorld();
+  void UnlockWorld();
+
+ private:
+  static void* ThreadMain(void* arg);
+  void Run();
+
+  // Step the world once and publish a new snapshot.
+  void StepOnce();
+
+  static void* WorkerMain(void* arg);
+  void WorkerRun();
+
+  // Record the post-step snapshot using the worker pool: bodies are
+  // collected into body_scratch_ (fixing each one's output index),
+  // then the workers and the stepping thread fill disjoint chunks of
+  // the back buffer.  Called with the world lock held.
+  void RecordSnapshotParallel();
+
+  // Claim and fill snapshot chunks until none are left.  Run by the
+  // pool workers and by the stepping thread itself.
+  void ProcessSnapshotChunks();
+
+  b2World* world_;
+  float timestep_;
+  volatile bool running_;
+  pthread_t thread_;
+
+  // Protects world_ against concurrent stepping and mutation.
+  pthread_mutex_t world_mutex_;
+
+  // Protects the front/back snapshot buffers during swap.
+  pthread_mutex_t snapshot_mutex_;
+
+  // Double-buffered body transforms.  The physics thread fills
+  // back_buffer_ and swaps; readers copy from front_buffer_.
+  SnapshotList* front_buffer_;
+  SnapshotList* back_buffer_;
+  SnapshotList buffers_[2];
+
+  // Iteration counts passed to b2World::Step.
+  int velocity_iterations_;
+  int position_iterations_;
+
+  // Snapshot worker pool (see SetParallelEnabled).
+  static const int kNumWorkers = 2;
+  pthread_t workers_[kNumWorkers];
+  bool pool_running_;
+
+  // Protects the dispatch state below and parks idle workers.
+  pthread_mutex_t pool_mutex_;
+  pthread_cond_t pool_wake_;
+  pthread_cond_t pool_done_;
+
+  // Bumped once per dispatch so parked workers can tell a new batch
+  // of chunks from a spurious wakeup.
+  unsigned step_generation_;
+  int workers_done_;
+
+  // Next unclaimed chunk index, advanced with an atomic add by
+  // whichever thread grabs the chunk.
+  volatile int next_chunk_;
+
+  // Non-static bodies collected for the current dispatch; entry i
+  // fills slot i of the back buffer.
+  std::vector<b2Body*> body_scratch_;
+};
+
+#endif  // PHYSICS_THREAD_H_
@@ -0,0 +1,137 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "resource_pack.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "cocos2d.h"
+
+USING_NS_CC;
+
+namespace {
+
+const char kPackMagic[] = "NTRP";
+const unsigned int kPackVersion = 1;
+
+// Read a little-endian uint32 from the given position.
+unsigned int ReadU32(const char* data) {
+  unsigned int value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// mkdir -p for the directory part of |path|.
+bool MakeParentDirs(const std::string& path) {
+  size_t pos = 0;
+  while ((pos = path.find('/', pos + 1)) != std::string::npos) {
+    std::string dir = path.substr(0, pos);
+    if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST)
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+ResourcePack* ResourcePack::sharedPack() {
+  static ResourcePack* shared_pack = NULL;
+  if (!shared_pack)
+    shared_pack = new ResourcePack();
+  return shared_pack;
+}
+
+bool ResourcePack::Load(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return false;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  data_.resize(size);
+  if (fread(&data_[0], 1, size, file) != (size_t)size) {
+    fclose(file);
+    data_.clear();
+    return false;
+  }
+  fclose(file);
+
+  if (size < 12 || memcmp(&data_[0], kPackMagic, 4) ||
+      ReadU32(&data_[4]) != kPackVersion) {
+    data_.clear();
+    return false;
+  }
+
+  unsigned int count = ReadU32(&data_[8]);
+  size_t pos = 12;
+  for (unsigned int i = 0; i < count; i++) {
+    if (pos + 4 > data_.size())
+      return false;
+    unsigned int path_len = ReadU32(&data_[pos]);
+    pos += 4;
+    if (pos + path_len + 8 > data_.size())
+      return false;
+    std::string name(&data_[pos], path_len);
+    pos += path_len;
+    EntryInfo info;
+    info.offset = ReadU32(&data_[pos]);
+    info.size = ReadU32(&data_[pos + 4]);
+    pos += 8;
+    if (info.offset + info.size > data_.size())
+      return false;
+    entries_[name] = info;
+  }
+
+  CCLog("loaded resource pack: %u files, %ld bytes", count, size);
+  loaded_ = true;
+  return true;
+}
+
+const char* ResourcePack::GetFile(const char* path, size_t* size) {
+  EntryMap::iterator it = entries_.find(path);
+  if (it == entries_.end())
+    return NULL;
+  if (size)
+    *size = it->second.size;
+  return &data_[it->second.offset];
+}
+
+bool ResourcePack::Mount(const char* root) {
+  if (!loaded_)
+    return false;
+
+  std::string prefix = root;
+  if (prefix[prefix.size() - 1] != '/')
+    prefix += '/';
+
+  if (mkdir(root, 0777) != 0 && errno != EEXIST)
+    return false;
+
+  for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+    std::string path = prefix + it->first;
+    if (!MakeParentDirs(path))
+      return false;
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+      return false;
+    const EntryInfo& info = it->second;
+    size_t written = fwrite(&data_[info.offset], 1, info.size, file);
+    fclose(file);
+    if (written != info.size)
+      return false;
+  }
+
+  // Put the mounted root at the front of the search path so every
+  // fullPathForFilename lookup resolves to memory before the httpfs
+  // paths are tried.
+  CCFileUtils* utils = CCFileUtils::sharedFileUtils();
+  std::vector<std::string> search_paths = utils->getSearchPaths();
+  search_paths.insert(search_paths.begin(), prefix);
+  utils->setSearchPaths(search_paths);
+  return true;
+}
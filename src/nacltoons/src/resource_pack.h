@@ -0,0 +1,58 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef RESOURCE_PACK_H_
+#define RESOURCE_PACK_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Reader for the packed resource archive produced by
+ * build/pack_resources.py.  The whole pack is fetched in a single
+ * read at startup (one HTTP round trip through nacl_io instead of
+ * one per resource file) and kept in memory.  Native callers get
+ * zero-copy pointers into the pack via GetFile(); fopen-based
+ * consumers (textures, sounds, lua source) are served by Mount(),
+ * which materialises the entries on an in-memory filesystem that is
+ * then put at the front of the CCFileUtils search path.
+ */
+class ResourcePack {
+ public:
+  static ResourcePack* sharedPack();
+
+  // Load and index the pack at the given path.  Returns false if the
+  // file is missing or malformed (callers then fall back to loose
+  // per-file fetches).
+  bool Load(const char* path);
+
+  bool loaded() { return loaded_; }
+
+  // Return a pointer to the named file's data within the in-memory
+  // pack (no copy), or NULL if the pack does not contain it.  |path|
+  // is relative to the packed resource root, forward slashes.
+  const char* GetFile(const char* path, size_t* size);
+
+  // Write every entry out under |root| (an in-memory filesystem on
+  // NaCl) and prepend |root| to the CCFileUtils search path, so all
+  // existing fopen/fullPathForFilename consumers read from memory.
+  // Returns false if the pack is not loaded or |root| is not
+  // writable.
+  bool Mount(const char* root);
+
+ private:
+  ResourcePack() : loaded_(false) {}
+
+  struct EntryInfo {
+    size_t offset;
+    size_t size;
+  };
+  typedef std::map<std::string, EntryInfo> EntryMap;
+
+  bool loaded_;
+  std::vector<char> data_;
+  EntryMap entries_;
+};
+
+#endif  // RESOURCE_PACK_H_
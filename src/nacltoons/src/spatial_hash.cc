@@ -0,0 +1,60 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "spatial_hash.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+SpatialHash::SpatialHash(float cell_size) : cell_size_(cell_size) {
+}
+
+SpatialHash::CellKey SpatialHash::KeyForCell(int cell_x, int cell_y) {
+  return ((CellKey)cell_x << 32) | (CellKey)(unsigned int)cell_y;
+}
+
+void SpatialHash::Insert(b2Fixture* fixture, const b2AABB& aabb) {
+  int min_x = (int)floorf(aabb.lowerBound.x / cell_size_);
+  int min_y = (int)floorf(aabb.lowerBound.y / cell_size_);
+  int max_x = (int)floorf(aabb.upperBound.x / cell_size_);
+  int max_y = (int)floorf(aabb.upperBound.y / cell_size_);
+  for (int x = min_x; x <= max_x; x++)
+    for (int y = min_y; y <= max_y; y++)
+      cells_[KeyForCell(x, y)].push_back(fixture);
+}
+
+void SpatialHash::Rebuild(b2World* world) {
+  cells_.clear();
+  for (b2Body* body = world->GetBodyList(); body; body = body->GetNext()) {
+    for (b2Fixture* fixture = body->GetFixtureList(); fixture;
+         fixture = fixture->GetNext()) {
+      // Fixtures with multi-child shapes (chains) have one AABB per
+      // child; bin them all.
+      int child_count = fixture->GetShape()->GetChildCount();
+      for (int child = 0; child < child_count; child++)
+        Insert(fixture, fixture->GetAABB(child));
+    }
+  }
+}
+
+void SpatialHash::QueryPoint(const b2Vec2& point, std::vector<b2Body*>* out) {
+  int cell_x = (int)floorf(point.x / cell_size_);
+  int cell_y = (int)floorf(point.y / cell_size_);
+  CellMap::iterator it = cells_.find(KeyForCell(cell_x, cell_y));
+  if (it == cells_.end())
+    return;
+
+  size_t first_hit = out->size();
+  FixtureList& fixtures = it->second;
+  for (size_t i = 0; i < fixtures.size(); i++) {
+    b2Fixture* fixture = fixtures[i];
+    if (!fixture->TestPoint(point))
+      continue;
+    b2Body* body = fixture->GetBody();
+    // Filter out bodies already reported for this query point.
+    if (std::find(out->begin() + first_hit, out->end(), body) == out->end())
+      out->push_back(body);
+  }
+}
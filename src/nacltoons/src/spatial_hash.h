@@ -0,0 +1,49 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef SPATIAL_HASH_H_
+#define SPATIAL_HASH_H_
+
+#include <map>
+#include <vector>
+
+#include "Box2D/Box2D.h"
+
+/**
+ * Uniform-grid spatial index over the fixtures of a b2World,
+ * maintained alongside the world so that point queries (touch
+ * hit-testing) don't need to go through b2World::QueryAABB for every
+ * event.  The hash is rebuilt at most once per frame (see
+ * LevelLayer::FindBodiesAtPoints) and then serves any number of
+ * queries from the same snapshot.
+ */
+class SpatialHash {
+ public:
+  explicit SpatialHash(float cell_size);
+
+  // Re-bin every fixture in the world according to its current AABB.
+  void Rebuild(b2World* world);
+
+  // Find all bodies with a fixture containing the given point and
+  // append them to |out|.  Duplicate bodies (multiple fixtures at the
+  // same point) are filtered out.
+  void QueryPoint(const b2Vec2& point, std::vector<b2Body*>* out);
+
+ private:
+  // Key for a grid cell; packs the two cell coordinates into one
+  // value so a std::map can be used.
+  typedef long long CellKey;
+
+  CellKey KeyForCell(int cell_x, int cell_y);
+
+  // Insert the fixture into every cell covered by the given AABB.
+  void Insert(b2Fixture* fixture, const b2AABB& aabb);
+
+  typedef std::vector<b2Fixture*> FixtureList;
+  typedef std::map<CellKey, FixtureList> CellMap;
+
+  float cell_size_;
+  CellMap cells_;
+};
+
+#endif  // SPATIAL_HASH_H_
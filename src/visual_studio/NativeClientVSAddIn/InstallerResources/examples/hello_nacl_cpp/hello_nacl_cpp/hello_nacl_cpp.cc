@@ -82,13 +82,26 @@
 
 #ifdef STEP2
 // includes for PPAPI C++
+#include <string.h>
+#include "ppapi/c/pp_stdint.h"
 #include "ppapi/cpp/instance.h"
 #include "ppapi/cpp/module.h"
 #include "ppapi/cpp/var.h"
+#include "ppapi/cpp/var_array_buffer.h"
 #include "ppapi/cpp/core.h"
 #include "ppapi/cpp/completion_callback.h"
 #include "ppapi/utility/completion_callback_factory.h"
 
+// Main-thread task scheduler shared with the hello_world_gles example.
+#include "../../hello_world_gles/hello_world_gles/task_scheduler.h"
+
+#ifdef STEP6
+// The worker-thread compute stage needs pthreads, which only exist in
+// the NaCl toolchain build.
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 // This is a known PPAPI platform problem (Issue 81375).
 // When WinUser.h is included it defines PostMessage, so we undef it here.
 // There is a work-around:
@@ -106,21 +119,206 @@ void InitInstanceInBrowserWindow();
 
 // **** Native Client Framework ****
 
+// Binary messaging channel.
+//
+// High-rate data (telemetry, input state) goes to the page as packed
+// little-endian records batched into one pp::VarArrayBuffer per
+// PostMessage, instead of a formatted string Var per event.  Wire
+// format, 4-byte aligned throughout:
+//
+//   message := record_count:u32  record*
+//   record  := type:u16  payload_len:u16  payload bytes (padded to 4)
+//
+// The JS side reads it with a DataView; string PostMessage stays
+// available for debugging.
+class BinaryMessenger {
+ public:
+  explicit BinaryMessenger(pp::Instance* instance)
+      : instance_(instance), used_(0), count_(0) {}
+
+  // Append one record to the pending batch, flushing first if it
+  // would not fit.
+  void PostRecord(uint16_t type, const void* payload,
+                  uint16_t payload_len) {
+    uint32_t padded = (payload_len + 3u) & ~3u;
+    uint32_t needed = 2 * sizeof(uint16_t) + padded;
+    if (used_ + needed > sizeof(batch_))
+      Flush();
+
+    char* out = batch_ + used_;
+    memcpy(out, &type, sizeof(uint16_t));
+    memcpy(out + 2, &payload_len, sizeof(uint16_t));
+    memcpy(out + 4, payload, payload_len);
+    memset(out + 4 + payload_len, 0, padded - payload_len);
+    used_ += needed;
+    count_++;
+  }
+
+  // Send all batched records in a single VarArrayBuffer.
+  void Flush() {
+    if (!count_)
+      return;
+    pp::VarArrayBuffer buffer(sizeof(uint32_t) + used_);
+    char* data = static_cast<char*>(buffer.Map());
+    memcpy(data, &count_, sizeof(uint32_t));
+    memcpy(data + sizeof(uint32_t), batch_, used_);
+    buffer.Unmap();
+    instance_->PostMessage(buffer);
+    used_ = 0;
+    count_ = 0;
+  }
+
+ private:
+  pp::Instance* instance_;
+  char batch_[4096];
+  uint32_t used_;
+  uint32_t count_;
+};
+
+// Record types used on the binary channel.
+const uint16_t kMsgRecordHello = 1;       // payload: id:u32
+const uint16_t kMsgRecordHashResult = 2;  // payload: id:u32, hash:u32
+const uint16_t kMsgRecordQueueDepth = 3;  // payload: requests:u32, results:u32
+
+#ifdef STEP6
+
+// **** Worker-thread compute stage ****
+//
+// HandleMessage only enqueues: requests go into a lock-free
+// single-producer/single-consumer ring consumed by a worker pthread,
+// results come back through a second ring and are delivered to the
+// page in batches — the worker schedules at most one CallOnMainThread
+// drain at a time, so a burst of results costs one main-thread hop.
+// Queue depths ride along with every batch so derived apps can watch
+// for backpressure.
+
+struct WorkRequest {
+  uint32_t id;
+  char text[64];
+};
+
+struct WorkResult {
+  uint32_t id;
+  uint32_t hash;
+};
+
+// Fixed-size SPSC ring.  With exactly one producer and one consumer,
+// each index is written by only one side, so a full barrier between
+// the payload write and the index publish is all the synchronization
+// needed — no locks on the hot path.
+template <typename T>
+class SpscQueue {
+ public:
+  SpscQueue() : head_(0), tail_(0) {}
+
+  bool Push(const T& item) {
+    uint32_t head = head_;
+    if (head - tail_ >= kCapacity)
+      return false;  // full
+    items_[head % kCapacity] = item;
+    __sync_synchronize();
+    head_ = head + 1;
+    return true;
+  }
+
+  bool Pop(T* item) {
+    uint32_t tail = tail_;
+    if (tail == head_)
+      return false;  // empty
+    __sync_synchronize();
+    *item = items_[tail % kCapacity];
+    __sync_synchronize();
+    tail_ = tail + 1;
+    return true;
+  }
+
+  uint32_t Depth() const { return head_ - tail_; }
+
+ private:
+  static const uint32_t kCapacity = 64;
+  volatile uint32_t head_;
+  volatile uint32_t tail_;
+  T items_[64];
+};
+
+SpscQueue<WorkRequest> workRequests;
+SpscQueue<WorkResult> workResults;
+pthread_t workerThread;
+bool workerStarted = false;
+// The rings are lock-free; this pair only parks the worker when the
+// request ring is empty.
+pthread_mutex_t workerLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t workerWake = PTHREAD_COND_INITIALIZER;
+volatile int drainPending = 0;
+
+void DrainResults(void* user_data, int32_t result);
+
+uint32_t HashText(const char* text) {
+  // FNV-1a, standing in for the real per-request computation.
+  uint32_t hash = 2166136261u;
+  while (*text) {
+    hash ^= (uint32_t) (unsigned char) *text++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void* WorkerMain(void* unused) {
+  for (;;) {
+    WorkRequest req;
+    if (!workRequests.Pop(&req)) {
+      pthread_mutex_lock(&workerLock);
+      while (workRequests.Depth() == 0)
+        pthread_cond_wait(&workerWake, &workerLock);
+      pthread_mutex_unlock(&workerLock);
+      continue;
+    }
+
+    WorkResult res;
+    res.id = req.id;
+    res.hash = HashText(req.text);
+    while (!workResults.Push(res)) {
+      // Result ring full: the main thread is behind; let the pending
+      // drain catch up.
+      sched_yield();
+    }
+
+    // One drain per burst: if a callback is already on its way to the
+    // main thread it will pick this result up too.
+    if (!drainPending) {
+      drainPending = 1;
+      pp::Module::Get()->core()->CallOnMainThread(
+          0, pp::CompletionCallback(DrainResults, NULL));
+    }
+  }
+  return NULL;
+}
+
+#endif  // STEP6
+
 // The Instance class.
 class NaClProjectInstance : public pp::Instance {
  public:
   explicit NaClProjectInstance(PP_Instance instance)
       : pp::Instance(instance),
       // Use this macro to eliminate compiler warning.
-      PP_ALLOW_THIS_IN_INITIALIZER_LIST(factory_(this)) {
+      PP_ALLOW_THIS_IN_INITIALIZER_LIST(factory_(this)),
+      PP_ALLOW_THIS_IN_INITIALIZER_LIST(messenger_(this)) {
     myInstance = this;
+#ifdef STEP6
+    next_request_id_ = 0;
+#endif
   }
 
+  BinaryMessenger& messenger() { return messenger_; }
+
   virtual ~NaClProjectInstance() {
   }
 
   virtual bool Init(uint32_t argc, const char* argn[],
                     const char* argv[]) {
+    TaskSchedulerInit((PPB_Core*)
+        pp::Module::Get()->GetBrowserInterface(PPB_CORE_INTERFACE));
     PostMessage(pp::Var("Creating Instance Start"));
 #ifdef STEP5
     // Will be included in STEP5 and STEP6
@@ -138,32 +336,80 @@ class NaClProjectInstance : public pp::Instance {
   }
 
 #ifdef STEP4
-  // Implements Windows window message loop with a callback function.
-  void NaClProjectInstance::SendCallback(int result) {
-    pp::Core* core = pp::Module::Get()->core();
-    core->CallOnMainThread(
-        100,
-        factory_.NewCallback(&NaClProjectInstance::HandleWindowMsg),
-        result);
-  }
-
-  void HandleWindowMsg(int32_t result) {
+  // Implements the Windows window message loop as an idle-priority
+  // task on the shared scheduler: it pumps pending messages when its
+  // 100ms deadline comes up and reposts itself, so there is no
+  // hand-rolled CallOnMainThread chain and no zero-delay polling.
+  static void PumpWindowsMessages(void* user_data) {
     MSG uMsg;
     if (PeekMessage(&uMsg, NULL, 0, 0, PM_REMOVE)) {
       TranslateMessage(&uMsg);
       DispatchMessage(&uMsg);
     }
-    SendCallback(0);
+    TaskSchedulerPost(TASK_PRIORITY_IDLE, 0.1, PumpWindowsMessages, NULL);
+  }
+
+  void SendCallback(int result) {
+    TaskSchedulerPost(TASK_PRIORITY_IDLE, 0.1, PumpWindowsMessages, NULL);
   }
 
 #endif
  private:
   virtual void HandleMessage(const pp::Var& var_message) {
+#ifdef STEP6
+    // Enqueue only; the worker pthread does the computing and results
+    // return in batches via DrainResults.  Input handling never waits
+    // on compute.
+    if (!var_message.is_string())
+      return;
+
+    if (!workerStarted) {
+      pthread_create(&workerThread, NULL, WorkerMain, NULL);
+      workerStarted = true;
+    }
+
+    WorkRequest req;
+    req.id = next_request_id_++;
+    strncpy(req.text, var_message.AsString().c_str(), sizeof(req.text) - 1);
+    req.text[sizeof(req.text) - 1] = '\0';
+
+    if (!workRequests.Push(req)) {
+      PostMessage(pp::Var("Request queue full, dropping message"));
+      return;
+    }
+    pthread_mutex_lock(&workerLock);
+    pthread_cond_signal(&workerWake);
+    pthread_mutex_unlock(&workerLock);
+#endif
   }
 
   pp::CompletionCallbackFactory<NaClProjectInstance> factory_;
+  BinaryMessenger messenger_;
+#ifdef STEP6
+  uint32_t next_request_id_;
+#endif
 };
 
+#ifdef STEP6
+// Runs on the main thread: move everything the worker has produced
+// since the last drain onto the binary channel in one batch, with the
+// current queue depths appended.
+void DrainResults(void* user_data, int32_t result) {
+  drainPending = 0;
+  BinaryMessenger& messenger = myInstance->messenger();
+
+  WorkResult res;
+  while (workResults.Pop(&res))
+    messenger.PostRecord(kMsgRecordHashResult, &res, sizeof(res));
+
+  struct { uint32_t requests; uint32_t results; } depth;
+  depth.requests = workRequests.Depth();
+  depth.results = workResults.Depth();
+  messenger.PostRecord(kMsgRecordQueueDepth, &depth, sizeof(depth));
+  messenger.Flush();
+}
+#endif
+
 // The Module class.
 class NaClProjectModule : public pp::Module {
  public:
@@ -360,5 +606,12 @@ int InitInstanceInPCWindow()
 // module's embed view.
 void InitInstanceInBrowserWindow() {
   myInstance->PostMessage(pp::Var("Hello, Native Client!"));
+
+  // The same greeting over the binary channel.  Real apps batch many
+  // records before Flush().
+  uint32_t greeting_id = 1;
+  myInstance->messenger().PostRecord(kMsgRecordHello, &greeting_id,
+                                     sizeof(greeting_id));
+  myInstance->messenger().Flush();
 }
 #endif
@@ -39,12 +39,14 @@
 #include "ppapi/c/ppp_messaging.h"
 #include "ppapi/c/ppb_url_loader.h"
 #include "ppapi/c/ppb_url_request_info.h"
+#include "ppapi/c/ppb_var_array_buffer.h"
 
 #include "ppapi/c/ppp_graphics_3d.h"
 #include "ppapi/lib/gl/gles2/gl2ext_ppapi.h"
 
 #include <GLES2/gl2.h>
 #include "matrix.h"
+#include "task_scheduler.h"
 
 static PPB_Messaging* ppb_messaging_interface = NULL;
 static PPB_Var* ppb_var_interface = NULL;
@@ -53,6 +55,7 @@ static PPB_Graphics3D* ppb_g3d_interface = NULL;
 static PPB_Instance* ppb_instance_interface = NULL;
 static PPB_URLRequestInfo* ppb_urlrequestinfo_interface = NULL;
 static PPB_URLLoader* ppb_urlloader_interface = NULL;
+static PPB_VarArrayBuffer* ppb_vararraybuffer_interface = NULL;
 
 static PP_Instance g_instance;
 static PP_Resource g_context;
@@ -63,7 +66,16 @@ GLuint  g_colorLoc;
 GLuint  g_MVPLoc;
 GLuint  g_vboID;
 GLuint  g_ibID;
-GLubyte g_Indices[36];
+
+// The cube is drawn kCubeInstances times from one persistent VBO: the
+// 24 base vertices are replicated with per-instance offsets baked into
+// their positions, and the index buffer repeats the 36 cube indices
+// with the matching vertex offset so the whole field is one
+// glDrawElements call.
+const int kCubeVerts = 24;
+const int kCubeIndices = 36;
+const int kCubeInstances = 2;
+GLubyte g_Indices[kCubeIndices * kCubeInstances];
 
 GLuint g_programObj;
 GLuint g_vertexShader;
@@ -85,12 +97,34 @@ struct Vertex
   float loc[3];
 };
 
-Vertex *g_quadVertices = NULL;
+Vertex *g_quadVertices = NULL;   // replicated instances, mirrors the VBO
+Vertex *g_cubeVertices = NULL;   // the 24 base vertices, never modified
+
+// Dirty-range tracking for the persistent VBO.  Render() uploads only
+// the spanned vertex range with glBufferSubData instead of re-sending
+// the whole buffer, and g_UploadBytesFrame counts what actually went
+// over the bus each frame.
+int g_DirtyFirst = 0;
+int g_DirtyCount = 0;
+uint32_t g_UploadBytesFrame = 0;
+
 const char *g_TextureData = NULL;
 const char *g_VShaderData = NULL;
 const char *g_FShaderData = NULL;
 int g_LoadCnt = 0;
 
+// Streaming state for the progressive texture upload.  The texture's
+// URL request is issued alongside the shaders', but instead of
+// waiting for the whole body, completed rows are handed to GL with
+// glTexSubImage2D as they arrive, so the first frame waits only for
+// the (small) shaders and never for the texture bytes.
+const int kTexWidth = 128;
+const int kTexHeight = 128;
+const int kTexRowBytes = kTexWidth * 3;  // GL_RGB, tightly packed
+const char *g_TexStreamBuf = NULL;
+int64_t g_TexStreamAvail = 0;
+int g_TexRowsUploaded = 0;
+
 //-----------------------------------------------------------------------------
 // PROTOTYPES
 //-----------------------------------------------------------------------------
@@ -126,19 +160,120 @@ void PostMessage(const char *fmt, ...) {
   va_end(args);
 }
 
+//-----------------------------------------------------------------------------
+// Binary messaging channel
+//
+// High-rate telemetry goes to the page as packed little-endian records
+// batched into a single VarArrayBuffer per PostMessage instead of one
+// formatted string Var per event.  Wire format, all fields uint32/float
+// sized and 4-byte aligned:
+//
+//   message   := record_count:u32  record*
+//   record    := type:u16  payload_len:u16  payload bytes (padded to 4)
+//
+// The JS side reads it with a DataView.  The string PostMessage above
+// stays available for debugging.
+//-----------------------------------------------------------------------------
+#define MSG_RECORD_SPIN 1    /* payload: frame:u32, xrot:f32, yrot:f32 */
+#define MSG_RECORD_UPLOAD 2  /* payload: frame:u32, upload_bytes:u32 */
+
+static char g_MsgBatch[4096];
+static uint32_t g_MsgBatchUsed = 0;
+static uint32_t g_MsgBatchCount = 0;
+
+// Send all batched records in one VarArrayBuffer and reset the batch.
+void FlushRecords(void) {
+  if (!g_MsgBatchCount || !ppb_vararraybuffer_interface)
+    return;
+
+  uint32_t total = sizeof(uint32_t) + g_MsgBatchUsed;
+  struct PP_Var buffer = ppb_vararraybuffer_interface->Create(total);
+  char* data = (char *) ppb_vararraybuffer_interface->Map(buffer);
+  if (data) {
+    memcpy(data, &g_MsgBatchCount, sizeof(uint32_t));
+    memcpy(data + sizeof(uint32_t), g_MsgBatch, g_MsgBatchUsed);
+    ppb_vararraybuffer_interface->Unmap(buffer);
+    ppb_messaging_interface->PostMessage(g_instance, buffer);
+  }
+  ppb_var_interface->Release(buffer);
+  g_MsgBatchUsed = 0;
+  g_MsgBatchCount = 0;
+}
+
+// Append one record to the pending batch, flushing first if it would
+// not fit.
+void PostRecord(uint16_t type, const void *payload, uint16_t payload_len) {
+  uint32_t padded = (payload_len + 3u) & ~3u;
+  uint32_t needed = 2 * sizeof(uint16_t) + padded;
+  if (g_MsgBatchUsed + needed > sizeof(g_MsgBatch))
+    FlushRecords();
+  /* FlushRecords is a no-op when PPB_VarArrayBuffer is unavailable,
+   * so the batch may still be full; drop the record rather than
+   * writing past the end of the buffer. */
+  if (g_MsgBatchUsed + needed > sizeof(g_MsgBatch))
+    return;
+
+  char* out = g_MsgBatch + g_MsgBatchUsed;
+  memcpy(out, &type, sizeof(uint16_t));
+  memcpy(out + 2, &payload_len, sizeof(uint16_t));
+  memcpy(out + 4, payload, payload_len);
+  memset(out + 4 + payload_len, 0, padded - payload_len);
+  g_MsgBatchUsed += needed;
+  g_MsgBatchCount++;
+}
+
+// Periodic telemetry flush, run as idle-priority scheduled work: the
+// batch goes out roughly twice a second, whenever a frame has spare
+// time.
+void FlushTelemetry(void* user_data) {
+  FlushRecords();
+  TaskSchedulerPost(TASK_PRIORITY_IDLE, 0.5, FlushTelemetry, NULL);
+}
+
+// Upload any texture rows that have streamed in since the last call.
+// Safe to call at any point: does nothing until both the GL texture
+// and some new complete rows exist.
+void UploadTextureRows(void) {
+  if (!g_textureID || !g_TexStreamBuf)
+    return;
+
+  int rows = (int) (g_TexStreamAvail / kTexRowBytes);
+  if (rows > kTexHeight)
+    rows = kTexHeight;
+  if (rows <= g_TexRowsUploaded)
+    return;
+
+  glSetCurrentContextPPAPI(g_context);
+  glBindTexture(GL_TEXTURE_2D, g_textureID);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, g_TexRowsUploaded, kTexWidth,
+                  rows - g_TexRowsUploaded, GL_RGB, GL_UNSIGNED_BYTE,
+                  g_TexStreamBuf + g_TexRowsUploaded * kTexRowBytes);
+  g_TexRowsUploaded = rows;
+}
+
 void MainLoop(void* foo, int bar) {
-  if (g_LoadCnt == 3) {
+  // Rendering starts once both shaders have arrived and the GL
+  // context exists.  Each of those events calls back in here when it
+  // completes, so nothing spins through CallOnMainThread while
+  // loading; after that the loop is paced entirely by SwapBuffers.
+  if (!g_context)
+    return;
+  if (!g_programObj) {
+    if (g_LoadCnt < 2)
+      return;
     InitProgram();
-    g_LoadCnt++;
-  }
-  if (g_LoadCnt > 3) {
-    Render();
-    PP_CompletionCallback cc = PP_MakeCompletionCallback(MainLoop, 0);
-    ppb_g3d_interface->SwapBuffers(g_context, cc);
-  } else {
-    PP_CompletionCallback cc = PP_MakeCompletionCallback(MainLoop, 0);
-    ppb_core_interface->CallOnMainThread(0, cc, 0);
+    TaskSchedulerPost(TASK_PRIORITY_IDLE, 0.5, FlushTelemetry, NULL);
   }
+
+  Render();
+
+  // Drain due scheduled work, then budget idle-priority work into
+  // what is left of the frame.
+  TaskSchedulerRunDue();
+  TaskSchedulerRunIdle(0.002);
+
+  PP_CompletionCallback cc = PP_MakeCompletionCallback(MainLoop, 0);
+  ppb_g3d_interface->SwapBuffers(g_context, cc);
 }
 
 void InitGL(void)
@@ -192,25 +327,33 @@ void InitProgram( void )
   glAttachShader(g_programObj, g_fragmentShader);
   glLinkProgram(g_programObj);
 
+  // The VBO is allocated once here and then only ever updated through
+  // sub-range uploads (see UploadDirtyVertices).  The index buffer is
+  // immutable.
   glGenBuffers(1, &g_vboID);
   glBindBuffer(GL_ARRAY_BUFFER, g_vboID);
-  glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(Vertex), (void*)&g_quadVertices[0],
-               GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, kCubeVerts * kCubeInstances * sizeof(Vertex),
+               (void*)&g_quadVertices[0], GL_DYNAMIC_DRAW);
 
   glGenBuffers(1, &g_ibID);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ibID);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, 36 * sizeof(char), (void*)&g_Indices[0],
-               GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               kCubeIndices * kCubeInstances * sizeof(char),
+               (void*)&g_Indices[0], GL_STATIC_DRAW);
 
   //
-  // Create a texture to test out our fragment shader...
+  // Create a texture to test out our fragment shader...  Storage is
+  // allocated up front (data may still be in flight); whatever rows
+  // have already streamed in are uploaded now and the rest follow
+  // from the download progress callbacks.
   //
   glGenTextures(1, &g_textureID);
   glBindTexture(GL_TEXTURE_2D, g_textureID);
   glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 128, 128, 0, GL_RGB, GL_UNSIGNED_BYTE,
-               g_TextureData);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, kTexWidth, kTexHeight, 0, GL_RGB,
+               GL_UNSIGNED_BYTE, NULL);
+  UploadTextureRows();
 
   //
   // Locate some parameters by name so we can set them later...
@@ -239,6 +382,35 @@ void BuildQuad(Vertex* verts, int axis[3], float depth, float color[3]) {
 }
 
 
+// Grow the dirty range to cover [first, first + count).
+void MarkVerticesDirty(int first, int count) {
+  if (g_DirtyCount == 0) {
+    g_DirtyFirst = first;
+    g_DirtyCount = count;
+    return;
+  }
+  int last = g_DirtyFirst + g_DirtyCount;
+  if (first + count > last)
+    last = first + count;
+  if (first < g_DirtyFirst)
+    g_DirtyFirst = first;
+  g_DirtyCount = last - g_DirtyFirst;
+}
+
+// Send only the dirty vertex range to the persistent VBO.  The buffer
+// itself is allocated once in InitProgram; this is the only upload
+// path after that.
+void UploadDirtyVertices(void) {
+  if (g_DirtyCount == 0)
+    return;
+  GLsizeiptr bytes = g_DirtyCount * sizeof(Vertex);
+  glBindBuffer(GL_ARRAY_BUFFER, g_vboID);
+  glBufferSubData(GL_ARRAY_BUFFER, g_DirtyFirst * sizeof(Vertex), bytes,
+                  &g_quadVertices[g_DirtyFirst]);
+  g_UploadBytesFrame += (uint32_t) bytes;
+  g_DirtyCount = 0;
+}
+
 Vertex *BuildCube() {
   Vertex *verts = new Vertex[24];
   for (int i = 0; i < 3; i++) {
@@ -270,6 +442,33 @@ Vertex *BuildCube() {
 }
 
 
+static const float kInstanceOffset[kCubeInstances][3] = {
+  { -1.5f, 0.0f, 0.0f },
+  { 1.5f, 0.0f, 0.0f },
+};
+const float kInstanceScale = 0.6f;
+
+// Replicate the base cube (g_cubeVertices, indices built by BuildCube)
+// into the instance field the VBO holds, baking each instance's offset
+// and scale into its positions and repeating the index pattern with
+// the matching vertex offset.
+Vertex *BuildCubeField() {
+  Vertex *verts = new Vertex[kCubeVerts * kCubeInstances];
+  for (int i = 0; i < kCubeInstances; i++) {
+    for (int v = 0; v < kCubeVerts; v++) {
+      Vertex* out = &verts[i * kCubeVerts + v];
+      *out = g_cubeVertices[v];
+      for (int j = 0; j < 3; j++)
+        out->loc[j] = out->loc[j] * kInstanceScale + kInstanceOffset[i][j];
+    }
+    for (int n = 0; n < kCubeIndices; n++)
+      g_Indices[i * kCubeIndices + n] =
+          (GLubyte) (g_Indices[n] + i * kCubeVerts);
+  }
+  return verts;
+}
+
+
 void Render( void )
 {
   static float xRot = 0.0;
@@ -305,6 +504,19 @@ void Render( void )
   multiply_matrix(mpv, trs, mpv);
   glUniformMatrix4fv(g_MVPLoc, 1, GL_FALSE, (GLfloat*) mpv);
 
+  // Pulse the second cube by rewriting its 24 vertices in the CPU
+  // mirror; the dirty-range path then uploads just that slice of the
+  // persistent VBO rather than the whole buffer.
+  float pulse = kInstanceScale *
+      (1.0f + 0.15f * sinf(xRot * (float) (M_PI / 180.0f) * 2.0f));
+  for (int v = 0; v < kCubeVerts; v++) {
+    Vertex* out = &g_quadVertices[kCubeVerts + v];
+    for (int j = 0; j < 3; j++)
+      out->loc[j] = g_cubeVertices[v].loc[j] * pulse + kInstanceOffset[1][j];
+  }
+  MarkVerticesDirty(kCubeVerts, kCubeVerts);
+  UploadDirtyVertices();
+
   //define the attributes of the vertex
   glBindBuffer(GL_ARRAY_BUFFER, g_vboID);
   glVertexAttribPointer(g_positionLoc, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex,loc));
@@ -315,11 +527,31 @@ void Render( void )
   glEnableVertexAttribArray(g_colorLoc);
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ibID);
-  glDrawElements ( GL_TRIANGLES, 36, GL_UNSIGNED_BYTE ,0 );
+  glDrawElements ( GL_TRIANGLES, kCubeIndices * kCubeInstances,
+                   GL_UNSIGNED_BYTE, 0 );
+
+  // Per-frame telemetry over the binary channel: one spin record and
+  // one upload-bytes record per frame, one PostMessage per 30 frames.
+  static uint32_t frame = 0;
+  struct { uint32_t frame; float xrot; float yrot; } spin;
+  spin.frame = frame++;
+  spin.xrot = xRot;
+  spin.yrot = yRot;
+  PostRecord(MSG_RECORD_SPIN, &spin, sizeof(spin));
+
+  struct { uint32_t frame; uint32_t bytes; } upload;
+  upload.frame = spin.frame;
+  upload.bytes = g_UploadBytesFrame;
+  PostRecord(MSG_RECORD_UPLOAD, &upload, sizeof(upload));
+  g_UploadBytesFrame = 0;
 }
 
 
 typedef void (*OpenCB)(void *dataPtr);
+// Optional per-read hook: called after every chunk lands in buf_ with
+// the bytes available so far, letting the consumer process the body
+// while it is still streaming (e.g. progressive texture upload).
+typedef void (*ProgressCB)(const char* buf, int64_t avail);
 struct OpenRequest {
   PP_Resource loader_;
   PP_Resource request_;
@@ -328,6 +560,7 @@ struct OpenRequest {
   int64_t size_;
   int64_t avail_;
   OpenCB cb_;
+  ProgressCB progress_cb_;
 };
 
 
@@ -353,6 +586,8 @@ static void URLPartialRead(void* user_data, int mode) {
   }
 
   req->avail_ += mode;
+  if (req->progress_cb_ && mode > 0)
+    req->progress_cb_(req->buf_, req->avail_);
   total = req->size_ - req->avail_;
 
   cnt = (total > LONG_MAX) ? LONG_MAX : (int32_t) total;
@@ -407,13 +642,15 @@ static void URLOpened(void* user_data, int mode) {
   URLPartialRead(req, bytes);
 }
 
-void LoadURL(PP_Instance inst, const char *url, OpenCB cb, void *data) {
+void LoadURLStreaming(PP_Instance inst, const char *url, OpenCB cb,
+                      ProgressCB progress, void *data) {
   OpenRequest* req = (OpenRequest*) malloc(sizeof(OpenRequest));
   memset(req, 0, sizeof(OpenRequest));
 
   req->loader_ = ppb_urlloader_interface->Create(inst);
   req->request_ = ppb_urlrequestinfo_interface->Create(inst);
   req->cb_ = cb;
+  req->progress_cb_ = progress;
   req->data_ = data;
 
   if (!req->loader_ || !req->request_) {
@@ -438,17 +675,51 @@ void LoadURL(PP_Instance inst, const char *url, OpenCB cb, void *data) {
   }
 }
 
+void LoadURL(PP_Instance inst, const char *url, OpenCB cb, void *data) {
+  LoadURLStreaming(inst, url, cb, NULL, data);
+}
+
 void Loaded(void* data) {
   OpenRequest *req = (OpenRequest *) data;
   if (req && req->buf_) {
     char **pptr = (char **) req->data_;
     *pptr = req->buf_;
     g_LoadCnt++;
+    // The last gating asset starts the render loop (if the GL context
+    // is up; otherwise DidChangeView will).
+    if (g_LoadCnt == 2)
+      MainLoop(NULL, 0);
     return;
   }
   PostMessage("Failed to load asset.\n");
 }
 
+// Streaming hook for the texture body; runs on the main thread after
+// every chunk.  Until InitProgram has created the GL texture the rows
+// just accumulate and are caught up in one UploadTextureRows call.
+void TextureProgress(const char* buf, int64_t avail) {
+  g_TexStreamBuf = buf;
+  g_TexStreamAvail = avail;
+  UploadTextureRows();
+}
+
+// Completion callback for the texture.  Does not touch g_LoadCnt: the
+// first frame is gated only on the shaders.
+void TextureLoaded(void* data) {
+  OpenRequest *req = (OpenRequest *) data;
+  if (req && req->buf_) {
+    g_TextureData = req->buf_;
+    g_TexStreamBuf = req->buf_;
+    g_TexStreamAvail = req->size_;
+    UploadTextureRows();
+    return;
+  }
+  // The partially uploaded rows stay as-is; the buffer backing them
+  // has been freed, so stop referencing it.
+  g_TexStreamBuf = NULL;
+  PostMessage("Failed to load texture.\n");
+}
+
 
 /**
  * Called when the NaCl module is instantiated on the web page. The identifier
@@ -477,10 +748,15 @@ static PP_Bool Instance_DidCreate(PP_Instance instance,
                                   const char* argn[],
                                   const char* argv[]) {
   g_instance = instance;
-  LoadURL(instance, "hello.raw", Loaded, &g_TextureData);
+  // All three requests are issued up front and stream concurrently;
+  // the texture additionally uploads to GL row by row as its body
+  // arrives, so startup latency is bounded by the largest asset.
+  LoadURLStreaming(instance, "hello.raw", TextureLoaded, TextureProgress,
+                   NULL);
   LoadURL(instance, "vertex_shader_es2.vert", Loaded, &g_VShaderData);
   LoadURL(instance, "fragment_shader_es2.frag", Loaded, &g_FShaderData);
-  g_quadVertices = BuildCube();
+  g_cubeVertices = BuildCube();
+  g_quadVertices = BuildCubeField();
   return PP_TRUE;
 }
 
@@ -497,6 +773,7 @@ static void Instance_DidDestroy(PP_Instance instance) {
   delete[] g_VShaderData;
   delete[] g_FShaderData;
   delete[] g_quadVertices;
+  delete[] g_cubeVertices;
 }
 
 /**
@@ -567,6 +844,7 @@ static PP_Bool Instance_HandleDocumentLoad(PP_Instance instance,
 PP_EXPORT int32_t PPP_InitializeModule(PP_Module a_module_id,
                                        PPB_GetInterface get_browser) {
   ppb_core_interface = (PPB_Core*)(get_browser(PPB_CORE_INTERFACE));
+  TaskSchedulerInit(ppb_core_interface);
   ppb_instance_interface = (PPB_Instance*)get_browser(PPB_INSTANCE_INTERFACE);
   ppb_messaging_interface =
       (PPB_Messaging*)(get_browser(PPB_MESSAGING_INTERFACE));
@@ -575,6 +853,8 @@ PP_EXPORT int32_t PPP_InitializeModule(PP_Module a_module_id,
       (PPB_URLLoader*)(get_browser(PPB_URLLOADER_INTERFACE));
   ppb_urlrequestinfo_interface =
       (PPB_URLRequestInfo*)(get_browser(PPB_URLREQUESTINFO_INTERFACE));
+  ppb_vararraybuffer_interface =
+      (PPB_VarArrayBuffer*)(get_browser(PPB_VAR_ARRAY_BUFFER_INTERFACE));
   ppb_g3d_interface = (PPB_Graphics3D*)get_browser(PPB_GRAPHICS_3D_INTERFACE);
   if (!glInitializePPAPI(get_browser))
     return PP_ERROR_FAILED;
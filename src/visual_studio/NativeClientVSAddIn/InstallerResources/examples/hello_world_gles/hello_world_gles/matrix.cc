@@ -13,6 +13,21 @@
 #include "matrix.h"
 #define deg_to_rad(x) (x * (M_PI/180.0f))
 
+/* Pick a SIMD implementation for the matrix kernels at compile time.
+ * Plain SSE/NEON intrinsics generate validator-safe code under NaCl
+ * (unaligned loads are used throughout since Matrix_t only guarantees
+ * 4-byte alignment).  Unknown architectures fall back to the scalar
+ * path.
+ */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MATRIX_USE_SSE 1
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define MATRIX_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
 void glhFrustumf2(Matrix_t mat, GLfloat left, GLfloat right, GLfloat bottom,
                   GLfloat top, GLfloat znear, GLfloat zfar)
 {
@@ -56,6 +71,72 @@ void identity_matrix(Matrix_t mat) {
   mat[15] = 1.0;
 }
 
+#if defined(MATRIX_USE_SSE)
+
+void multiply_matrix(const Matrix_t a, const Matrix_t b, Matrix_t mat) {
+  // Load the columns of 'a' once; each output column is then a linear
+  // combination of them weighted by the corresponding column of 'b'.
+  // All loads complete before the stores, so aliasing of 'mat' with
+  // either input is safe without a temporary.
+  __m128 a0 = _mm_loadu_ps(a);
+  __m128 a1 = _mm_loadu_ps(a + 4);
+  __m128 a2 = _mm_loadu_ps(a + 8);
+  __m128 a3 = _mm_loadu_ps(a + 12);
+
+  __m128 out0, out1, out2, out3;
+  int col;
+  for (col = 0; col < 4; col++) {
+    const GLfloat* bcol = b + col * 4;
+    __m128 out = _mm_mul_ps(a0, _mm_set1_ps(bcol[0]));
+    out = _mm_add_ps(out, _mm_mul_ps(a1, _mm_set1_ps(bcol[1])));
+    out = _mm_add_ps(out, _mm_mul_ps(a2, _mm_set1_ps(bcol[2])));
+    out = _mm_add_ps(out, _mm_mul_ps(a3, _mm_set1_ps(bcol[3])));
+    switch (col) {
+      case 0: out0 = out; break;
+      case 1: out1 = out; break;
+      case 2: out2 = out; break;
+      default: out3 = out; break;
+    }
+  }
+
+  _mm_storeu_ps(mat, out0);
+  _mm_storeu_ps(mat + 4, out1);
+  _mm_storeu_ps(mat + 8, out2);
+  _mm_storeu_ps(mat + 12, out3);
+}
+
+#elif defined(MATRIX_USE_NEON)
+
+void multiply_matrix(const Matrix_t a, const Matrix_t b, Matrix_t mat) {
+  float32x4_t a0 = vld1q_f32(a);
+  float32x4_t a1 = vld1q_f32(a + 4);
+  float32x4_t a2 = vld1q_f32(a + 8);
+  float32x4_t a3 = vld1q_f32(a + 12);
+
+  float32x4_t out0, out1, out2, out3;
+  int col;
+  for (col = 0; col < 4; col++) {
+    const GLfloat* bcol = b + col * 4;
+    float32x4_t out = vmulq_n_f32(a0, bcol[0]);
+    out = vmlaq_n_f32(out, a1, bcol[1]);
+    out = vmlaq_n_f32(out, a2, bcol[2]);
+    out = vmlaq_n_f32(out, a3, bcol[3]);
+    switch (col) {
+      case 0: out0 = out; break;
+      case 1: out1 = out; break;
+      case 2: out2 = out; break;
+      default: out3 = out; break;
+    }
+  }
+
+  vst1q_f32(mat, out0);
+  vst1q_f32(mat + 4, out1);
+  vst1q_f32(mat + 8, out2);
+  vst1q_f32(mat + 12, out3);
+}
+
+#else
+
 void multiply_matrix(const Matrix_t a, const Matrix_t b, Matrix_t mat) {
   // Generate to a temporary first in case the output matrix and input
   // matrix are thes same.
@@ -84,6 +165,58 @@ void multiply_matrix(const Matrix_t a, const Matrix_t b, Matrix_t mat) {
   memcpy(mat, out, sizeof(Matrix_t));
 }
 
+#endif  // MATRIX_USE_SSE / MATRIX_USE_NEON
+
+void multiply_matrix_batch(const Matrix_t a, const Matrix_t* b,
+                           Matrix_t* mat, int count) {
+#if defined(MATRIX_USE_SSE)
+  // The shared left operand's columns stay in registers across the
+  // whole batch, so each matrix costs only the 16 broadcasts and 16
+  // multiply-adds of its own columns.
+  __m128 a0 = _mm_loadu_ps(a);
+  __m128 a1 = _mm_loadu_ps(a + 4);
+  __m128 a2 = _mm_loadu_ps(a + 8);
+  __m128 a3 = _mm_loadu_ps(a + 12);
+  int i, col;
+  for (i = 0; i < count; i++) {
+    // Compute all four columns before storing so mat may alias b
+    // (in-place transform of an array), as with multiply_matrix.
+    __m128 out[4];
+    for (col = 0; col < 4; col++) {
+      const GLfloat* bcol = b[i] + col * 4;
+      out[col] = _mm_mul_ps(a0, _mm_set1_ps(bcol[0]));
+      out[col] = _mm_add_ps(out[col], _mm_mul_ps(a1, _mm_set1_ps(bcol[1])));
+      out[col] = _mm_add_ps(out[col], _mm_mul_ps(a2, _mm_set1_ps(bcol[2])));
+      out[col] = _mm_add_ps(out[col], _mm_mul_ps(a3, _mm_set1_ps(bcol[3])));
+    }
+    for (col = 0; col < 4; col++)
+      _mm_storeu_ps(mat[i] + col * 4, out[col]);
+  }
+#elif defined(MATRIX_USE_NEON)
+  float32x4_t a0 = vld1q_f32(a);
+  float32x4_t a1 = vld1q_f32(a + 4);
+  float32x4_t a2 = vld1q_f32(a + 8);
+  float32x4_t a3 = vld1q_f32(a + 12);
+  int i, col;
+  for (i = 0; i < count; i++) {
+    float32x4_t out[4];
+    for (col = 0; col < 4; col++) {
+      const GLfloat* bcol = b[i] + col * 4;
+      out[col] = vmulq_n_f32(a0, bcol[0]);
+      out[col] = vmlaq_n_f32(out[col], a1, bcol[1]);
+      out[col] = vmlaq_n_f32(out[col], a2, bcol[2]);
+      out[col] = vmlaq_n_f32(out[col], a3, bcol[3]);
+    }
+    for (col = 0; col < 4; col++)
+      vst1q_f32(mat[i] + col * 4, out[col]);
+  }
+#else
+  int i;
+  for (i = 0; i < count; i++)
+    multiply_matrix(a, b[i], mat[i]);
+#endif
+}
+
 void rotate_x_matrix(GLfloat x_rad, Matrix_t mat) {
   identity_matrix(mat);
   mat[5] = cosf(x_rad);
@@ -108,23 +241,67 @@ void rotate_z_matrix(GLfloat z_rad, Matrix_t mat) {
   mat[5] = mat[0];
 }
 
-void rotate_matrix(GLfloat x_deg, GLfloat y_deg, GLfloat z_deg,
-                   Matrix_t mat) {
+void euler_rotation_matrix(GLfloat x_deg, GLfloat y_deg, GLfloat z_deg,
+                           Matrix_t mat) {
   GLfloat x_rad = (GLfloat) deg_to_rad(x_deg);
   GLfloat y_rad = (GLfloat) deg_to_rad(y_deg);
   GLfloat z_rad = (GLfloat) deg_to_rad(z_deg);
 
-  Matrix_t x_matrix;
-  Matrix_t y_matrix;
-  Matrix_t z_matrix;
+  GLfloat cx = cosf(x_rad);
+  GLfloat sx = sinf(x_rad);
+  GLfloat cy = cosf(y_rad);
+  GLfloat sy = sinf(y_rad);
+  GLfloat cz = cosf(z_rad);
+  GLfloat sz = sinf(z_rad);
+
+  // The expanded product z_matrix * y_matrix * x_matrix, written out
+  // directly so one rotation costs six sin/cos and a handful of
+  // multiplies instead of three identity fills and two general 4x4
+  // multiplies.
+  mat[0] = cz * cy;
+  mat[1] = sz * cy;
+  mat[2] = sy;
+  mat[3] = 0.0f;
+  mat[4] = cz * sy * sx - sz * cx;
+  mat[5] = sz * sy * sx + cz * cx;
+  mat[6] = -cy * sx;
+  mat[7] = 0.0f;
+  mat[8] = -cz * sy * cx - sz * sx;
+  mat[9] = cz * sx - sz * sy * cx;
+  mat[10] = cy * cx;
+  mat[11] = 0.0f;
+  mat[12] = 0.0f;
+  mat[13] = 0.0f;
+  mat[14] = 0.0f;
+  mat[15] = 1.0f;
+}
 
-  rotate_x_matrix(x_rad, x_matrix);
-  rotate_y_matrix(y_rad, y_matrix);
-  rotate_z_matrix(z_rad, z_matrix);
+void rotate_matrix(GLfloat x_deg, GLfloat y_deg, GLfloat z_deg,
+                   Matrix_t mat) {
+  euler_rotation_matrix(x_deg, y_deg, z_deg, mat);
+}
 
-  Matrix_t xy_matrix;
-  multiply_matrix(y_matrix, x_matrix, xy_matrix);
-  multiply_matrix(z_matrix, xy_matrix, mat);
+void rotate_translate_scale_matrix(GLfloat x_deg, GLfloat y_deg,
+                                   GLfloat z_deg, GLfloat tx, GLfloat ty,
+                                   GLfloat tz, GLfloat sx, GLfloat sy,
+                                   GLfloat sz, Matrix_t mat) {
+  // Equivalent to translate * rotation * scale composed with
+  // multiply_matrix, fused into one fill: scaling multiplies the
+  // rotation's columns and the translation lands in the last column
+  // untouched by either.
+  euler_rotation_matrix(x_deg, y_deg, z_deg, mat);
+  mat[0] *= sx;
+  mat[1] *= sx;
+  mat[2] *= sx;
+  mat[4] *= sy;
+  mat[5] *= sy;
+  mat[6] *= sy;
+  mat[8] *= sz;
+  mat[9] *= sz;
+  mat[10] *= sz;
+  mat[12] = tx;
+  mat[13] = ty;
+  mat[14] = tz;
 }
 
 void translate_matrix(GLfloat x, GLfloat y, GLfloat z, Matrix_t mat) {
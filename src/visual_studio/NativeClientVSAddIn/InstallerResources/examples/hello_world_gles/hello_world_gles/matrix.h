@@ -30,8 +30,32 @@ void glhPerspectivef2(Matrix_t mat, GLfloat fovyInDegrees,
 
 void identity_matrix(Matrix_t mat);
 void multiply_matrix(const Matrix_t a, const Matrix_t b, Matrix_t mat);
+
+/// Multiply each of the 'count' matrices in 'b' by the shared left
+/// operand 'a' in one pass (mat[i] = a * b[i]).  SIMD builds keep the
+/// columns of 'a' in registers across the whole batch, so this is
+/// noticeably cheaper than calling multiply_matrix in a loop when
+/// transforming many matrices per frame.  'mat' may alias 'b' for an
+/// in-place transform.
+void multiply_matrix_batch(const Matrix_t a, const Matrix_t* b,
+                           Matrix_t* mat, int count);
 void rotate_matrix(GLfloat x_deg, GLfloat y_deg, GLfloat z_deg, Matrix_t mat);
 void translate_matrix(GLfloat x, GLfloat y, GLfloat z, Matrix_t mat);
 
+/// Build the combined z*y*x Euler rotation directly from the six
+/// sin/cos values, in one pass.  Produces the same matrix as
+/// rotate_matrix (which now forwards here) without the three identity
+/// fills and two general multiplies of the original composition.
+void euler_rotation_matrix(GLfloat x_deg, GLfloat y_deg, GLfloat z_deg,
+                           Matrix_t mat);
+
+/// Build translate(tx,ty,tz) * rotation(x,y,z) * scale(sx,sy,sz) as a
+/// single fused fill — the usual per-object model matrix without any
+/// intermediate matrices or multiplies.
+void rotate_translate_scale_matrix(GLfloat x_deg, GLfloat y_deg,
+                                   GLfloat z_deg, GLfloat tx, GLfloat ty,
+                                   GLfloat tz, GLfloat sx, GLfloat sy,
+                                   GLfloat sz, Matrix_t mat);
+
 #endif  // EXAMPLES_HELLO_WORLD_GLES_MATRIX_H
 
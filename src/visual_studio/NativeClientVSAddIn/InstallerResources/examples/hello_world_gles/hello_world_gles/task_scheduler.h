@@ -0,0 +1,183 @@
+#ifndef EXAMPLES_HELLO_WORLD_GLES_TASK_SCHEDULER_H
+#define EXAMPLES_HELLO_WORLD_GLES_TASK_SCHEDULER_H
+
+/* Copyright (c) 2012 The Chromium Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/** @file task_scheduler.h
+ * A small cooperative scheduler for work on the Pepper main thread,
+ * shared by the example projects.
+ *
+ * Tasks are posted with a priority and a deadline.  Instead of
+ * spinning through CallOnMainThread with zero delay, the scheduler
+ * arms a single wakeup for the earliest pending deadline; while a
+ * render loop is running, TaskSchedulerRunDue/TaskSchedulerRunIdle
+ * can additionally be called after SwapBuffers to drain due work and
+ * budget low-priority work into the frame's idle time.
+ *
+ * Header-only and intentionally tiny: a fixed-size table scanned on
+ * each dispatch, which is plenty for the handful of tasks the
+ * examples schedule.
+ */
+
+#include "ppapi/c/pp_completion_callback.h"
+#include "ppapi/c/ppb_core.h"
+
+typedef void (*TaskFunc)(void* user_data);
+
+enum {
+  TASK_PRIORITY_FRAME = 0,    /* run at the first opportunity */
+  TASK_PRIORITY_DEFAULT = 1,  /* run when due */
+  TASK_PRIORITY_IDLE = 2      /* run when due, but only in idle time */
+};
+
+#define TASK_SCHEDULER_MAX_TASKS 64
+
+struct ScheduledTask {
+  TaskFunc func;
+  void* user_data;
+  int priority;
+  PP_TimeTicks deadline;
+  unsigned seq;  /* FIFO tiebreak for equal deadlines */
+};
+
+static PPB_Core* s_task_core = NULL;
+static struct ScheduledTask s_tasks[TASK_SCHEDULER_MAX_TASKS];
+static int s_task_count = 0;
+static unsigned s_task_seq = 0;
+static int s_task_pump_armed = 0;
+static PP_TimeTicks s_task_pump_deadline = 0;
+
+static void TaskSchedulerPump(void* unused, int32_t result);
+
+static void TaskSchedulerInit(PPB_Core* core) {
+  s_task_core = core;
+}
+
+static PP_TimeTicks TaskSchedulerNow(void) {
+  return s_task_core->GetTimeTicks();
+}
+
+/* Find the most urgent task: lowest priority value first, then
+ * earliest deadline, then posting order.  Returns -1 if none matches
+ * the filter.  'due_only' restricts to tasks whose deadline has
+ * passed; 'max_priority' excludes lower-priority classes.
+ */
+static int TaskSchedulerSelect(PP_TimeTicks now, int due_only,
+                               int max_priority) {
+  int best = -1;
+  int i;
+  for (i = 0; i < s_task_count; i++) {
+    if (s_tasks[i].priority > max_priority)
+      continue;
+    if (due_only && s_tasks[i].deadline > now)
+      continue;
+    if (best == -1 ||
+        s_tasks[i].priority < s_tasks[best].priority ||
+        (s_tasks[i].priority == s_tasks[best].priority &&
+         (s_tasks[i].deadline < s_tasks[best].deadline ||
+          (s_tasks[i].deadline == s_tasks[best].deadline &&
+           s_tasks[i].seq < s_tasks[best].seq))))
+      best = i;
+  }
+  return best;
+}
+
+static void TaskSchedulerRunTask(int index) {
+  struct ScheduledTask task = s_tasks[index];
+  s_tasks[index] = s_tasks[--s_task_count];
+  task.func(task.user_data);
+}
+
+/* Run every non-idle task whose deadline has passed.  Returns the
+ * number of tasks run.
+ */
+static int TaskSchedulerRunDue(void) {
+  int run = 0;
+  for (;;) {
+    int index = TaskSchedulerSelect(TaskSchedulerNow(), 1,
+                                    TASK_PRIORITY_DEFAULT);
+    if (index < 0)
+      return run;
+    TaskSchedulerRunTask(index);
+    run++;
+  }
+}
+
+/* Run due idle-priority tasks until 'budget_seconds' of wall time is
+ * spent.  Call this after the frame's real work, e.g. right before
+ * SwapBuffers.  Returns the number of tasks run.
+ */
+static int TaskSchedulerRunIdle(double budget_seconds) {
+  PP_TimeTicks end = TaskSchedulerNow() + budget_seconds;
+  int run = 0;
+  for (;;) {
+    PP_TimeTicks now = TaskSchedulerNow();
+    if (now >= end)
+      return run;
+    int index = TaskSchedulerSelect(now, 1, TASK_PRIORITY_IDLE);
+    if (index < 0)
+      return run;
+    TaskSchedulerRunTask(index);
+    run++;
+  }
+}
+
+/* Arm (or re-arm) the single CallOnMainThread wakeup for the earliest
+ * pending deadline.  No-op while already armed or with nothing
+ * pending, so the module never spins.
+ */
+static void TaskSchedulerArm(void) {
+  if (s_task_count == 0)
+    return;
+
+  PP_TimeTicks next = s_tasks[0].deadline;
+  int i;
+  for (i = 1; i < s_task_count; i++) {
+    if (s_tasks[i].deadline < next)
+      next = s_tasks[i].deadline;
+  }
+  /* An extra wakeup that finds nothing due is harmless, so only the
+   * case where the armed wakeup is already early enough is skipped.
+   */
+  if (s_task_pump_armed && s_task_pump_deadline <= next)
+    return;
+
+  double delay = (next - TaskSchedulerNow()) * 1000.0;
+  if (delay < 0)
+    delay = 0;
+
+  s_task_pump_armed = 1;
+  s_task_pump_deadline = next;
+  s_task_core->CallOnMainThread((int32_t) delay,
+      PP_MakeCompletionCallback(TaskSchedulerPump, NULL), 0);
+}
+
+static void TaskSchedulerPump(void* unused, int32_t result) {
+  s_task_pump_armed = 0;
+  TaskSchedulerRunDue();
+  TaskSchedulerRunIdle(0.001);
+  TaskSchedulerArm();
+}
+
+/* Post 'func' to run on the main thread no earlier than
+ * 'delay_seconds' from now.  Returns 0 if the table is full.
+ */
+static int TaskSchedulerPost(int priority, double delay_seconds,
+                             TaskFunc func, void* user_data) {
+  if (s_task_count >= TASK_SCHEDULER_MAX_TASKS)
+    return 0;
+
+  struct ScheduledTask* task = &s_tasks[s_task_count++];
+  task->func = func;
+  task->user_data = user_data;
+  task->priority = priority;
+  task->deadline = TaskSchedulerNow() + delay_seconds;
+  task->seq = s_task_seq++;
+  TaskSchedulerArm();
+  return 1;
+}
+
+#endif  /* EXAMPLES_HELLO_WORLD_GLES_TASK_SCHEDULER_H */